@@ -336,6 +336,70 @@ static void *SzAlloc(const ISzAlloc *p, size_t size) { return mem_alloc(size); }
 static void SzFree(const ISzAlloc *p, void *address) { MEM_FREE(address) };
 static const ISzAlloc g_Alloc = { SzAlloc, SzFree };
 
+/*
+ * Size of the leading part of the data we decrypt and decode before going
+ * for the whole thing, and cap on how much of its output we keep.
+ */
+#define PARTIAL_IN_SIZE         4096
+#define PARTIAL_OUT_SIZE        (64 << 10)
+
+/*
+ * A valid LZMA stream always starts with a zero byte (range coder init).
+ * The first LZMA2 chunk has to reset the dictionary: it is either a stored
+ * chunk (control byte 1) or an LZMA chunk with new properties (0xe0 and up),
+ * in which case we can also check the properties byte and the start of the
+ * LZMA stream that follows.
+ */
+static int lzma_header_valid(const uint8_t *buf, int c_type, size_t crc_len)
+{
+	if (c_type == 1)
+		return buf[0] == 0;
+
+	if (buf[0] == 0)
+		return crc_len == 0;
+	if (buf[0] == 1)
+		return 1;
+	if (buf[0] < 0xe0)
+		return 0;
+	if (buf[5] >= 9 * 5 * 5 || buf[5] % 9 + buf[5] / 9 % 5 > 4)
+		return 0;
+	return buf[6] == 0;
+}
+
+/*
+ * Decrypt and decode just the leading part of the data.  Running out of
+ * input or output is fine, but a data error here would be one for the whole
+ * stream too.
+ */
+static int lzma_partial_valid(AES_KEY *akey, int c_type, size_t crc_len)
+{
+	unsigned char iv[16];
+	uint8_t *in, *out;
+	size_t in_size = PARTIAL_IN_SIZE;
+	size_t out_size = MIN(crc_len, PARTIAL_OUT_SIZE);
+	ELzmaStatus status;
+	SRes rc;
+
+	in = mem_alloc(in_size);
+	out = mem_alloc(out_size);
+	memcpy(iv, sevenzip_salt->iv, 16);
+	AES_cbc_encrypt(sevenzip_salt->data, in, in_size, akey, iv, AES_DECRYPT);
+
+	if (c_type == 1)
+		rc = LzmaDecode(out, &out_size, in, &in_size,
+		                sevenzip_salt->decoder_props, LZMA_PROPS_SIZE,
+		                LZMA_FINISH_ANY, &status, &g_Alloc);
+	else
+		rc = Lzma2Decode(out, &out_size, in, &in_size,
+		                 sevenzip_salt->decoder_props[0], LZMA_FINISH_ANY,
+		                 &status, &g_Alloc);
+
+	MEM_FREE(out);
+	MEM_FREE(in);
+
+	return rc != SZ_ERROR_DATA;
+}
+
 int sevenzip_decrypt(unsigned char *derived_key)
 {
 	unsigned char *out = NULL;
@@ -397,6 +461,33 @@ int sevenzip_decrypt(unsigned char *derived_key)
 			return 1;
 	}
 
+	/*
+	 * Early rejection for LZMA and LZMA2: check the first block, then try
+	 * decoding a leading part of the data, before doing the whole thing.
+	 */
+	if ((c_type == 1 || c_type == 2) && sevenzip_salt->aes_length >= 16) {
+		uint8_t buf[16];
+
+		memcpy(iv, sevenzip_salt->iv, 16);
+		AES_set_decrypt_key(derived_key, 256, &akey);
+		AES_cbc_encrypt(sevenzip_salt->data, buf, 16, &akey, iv, AES_DECRYPT);
+		if (!lzma_header_valid(buf, c_type, crc_len)) {
+#if DEBUG
+			if (!benchmark_running && options.verbosity >= VERB_DEBUG)
+				fprintf(stderr, YEL "%s header check failed\n" NRM, comp_type[c_type]);
+#endif
+			return 0;
+		}
+		if (sevenzip_salt->packed_size > 2 * PARTIAL_IN_SIZE &&
+		    !lzma_partial_valid(&akey, c_type, crc_len)) {
+#if DEBUG
+			if (!benchmark_running && options.verbosity >= VERB_DEBUG)
+				fprintf(stderr, YEL "%s partial decoding failed\n" NRM, comp_type[c_type]);
+#endif
+			return 0;
+		}
+	}
+
 	/* Complete decryption */
 #if DEBUG
 	if (!benchmark_running && options.verbosity >= VERB_DEBUG)
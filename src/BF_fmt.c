@@ -52,6 +52,12 @@ static void init(struct fmt_main *self)
 {
 #ifdef _OPENMP
 	int n = BF_Nmin * omp_get_max_threads(), max;
+#if BF_SIMD
+	if (BF_std_select() == BF_SIMD) {
+		n = BF_SIMD * omp_get_max_threads();
+		fmt_BF.params.algorithm_name = BF_SIMD_ALGORITHM_NAME;
+	}
+#endif
 	if (n < BF_Nmin)
 		n = BF_Nmin;
 	if (n > BF_N)
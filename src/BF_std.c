@@ -33,6 +33,12 @@
 #include "arch.h"
 #include "common.h"
 #include "BF_std.h"
+#if BF_SIMD
+#include "pseudo_intrinsics.h"
+#include "aligned.h"
+#include "timer.h"
+#include <omp.h>
+#endif
 
 BF_binary BF_out[BF_N];
 
@@ -358,6 +364,174 @@ extern void (*BF_body)(void);
 
 #endif
 
+#if BF_SIMD
+/*
+ * BF_SIMD independent Blowfish contexts, one per vector lane.  The lanes of
+ * each S-box entry are adjacent, so the sequential S-box (and P-array) writes
+ * of the key setup are plain vector stores, and a lookup of byte x in lane i
+ * is a gather from [x * BF_SIMD + i].
+ */
+struct BF_simd_ctx {
+	BF_word S[4][0x100][BF_SIMD];
+	BF_word P[BF_ROUNDS + 2][BF_SIMD];
+};
+
+#if BF_SIMD == 16
+#define BF_SIMD_SHIFT			4
+static const BF_word JTR_ALIGN(MEM_ALIGN_SIMD) BF_simd_lanes[BF_SIMD] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+#elif BF_SIMD == 8
+#define BF_SIMD_SHIFT			3
+static const BF_word JTR_ALIGN(MEM_ALIGN_SIMD) BF_simd_lanes[BF_SIMD] = {
+	0, 1, 2, 3, 4, 5, 6, 7
+};
+#endif
+
+static int BF_use_simd;
+
+/* Gather indices for the byte of L at bit position shift, and for byte 0 */
+#define BF_SIMD_INDEX(L, shift) \
+	vor(vand(vsrli_epi32(L, shift - BF_SIMD_SHIFT), mask), lane)
+#define BF_SIMD_INDEX0(L) \
+	vor(vand(vslli_epi32(L, BF_SIMD_SHIFT), mask), lane)
+
+#define BF_SIMD_ROUND(L, R, N) \
+	tmp = vgather_epi32(ctx->S[0], BF_SIMD_INDEX(L, 24), 4); \
+	tmp = vadd_epi32(tmp, \
+	    vgather_epi32(ctx->S[1], BF_SIMD_INDEX(L, 16), 4)); \
+	tmp = vxor(tmp, vgather_epi32(ctx->S[2], BF_SIMD_INDEX(L, 8), 4)); \
+	tmp = vadd_epi32(tmp, vgather_epi32(ctx->S[3], BF_SIMD_INDEX0(L), 4)); \
+	R = vxor(R, vxor(tmp, vload(ctx->P[N + 1])));
+
+#define BF_SIMD_ENCRYPT(L, R) \
+	L = vxor(L, vload(ctx->P[0])); \
+	BF_SIMD_ROUND(L, R, 0); \
+	BF_SIMD_ROUND(R, L, 1); \
+	BF_SIMD_ROUND(L, R, 2); \
+	BF_SIMD_ROUND(R, L, 3); \
+	BF_SIMD_ROUND(L, R, 4); \
+	BF_SIMD_ROUND(R, L, 5); \
+	BF_SIMD_ROUND(L, R, 6); \
+	BF_SIMD_ROUND(R, L, 7); \
+	BF_SIMD_ROUND(L, R, 8); \
+	BF_SIMD_ROUND(R, L, 9); \
+	BF_SIMD_ROUND(L, R, 10); \
+	BF_SIMD_ROUND(R, L, 11); \
+	BF_SIMD_ROUND(L, R, 12); \
+	BF_SIMD_ROUND(R, L, 13); \
+	BF_SIMD_ROUND(L, R, 14); \
+	BF_SIMD_ROUND(R, L, 15); \
+	tmp = R; \
+	R = L; \
+	L = vxor(tmp, vload(ctx->P[BF_ROUNDS + 1]));
+
+/*
+ * Re-keys P and S by encrypting their own contents, as BF_body() does.
+ */
+static void BF_simd_body(struct BF_simd_ctx *ctx)
+{
+	const vtype mask = vset1_epi32(0xFF << BF_SIMD_SHIFT);
+	const vtype lane = vload(BF_simd_lanes);
+	vtype L, R, tmp;
+	BF_word *ptr;
+
+	L = R = vsetzero();
+	for (ptr = ctx->P[0]; ptr < ctx->P[BF_ROUNDS + 1]; ptr += 2 * BF_SIMD) {
+		BF_SIMD_ENCRYPT(L, R);
+		vstore(ptr, L);
+		vstore(ptr + BF_SIMD, R);
+	}
+	for (ptr = ctx->S[0][0]; ptr < ctx->S[3][0xFF]; ptr += 2 * BF_SIMD) {
+		BF_SIMD_ENCRYPT(L, R);
+		vstore(ptr, L);
+		vstore(ptr + BF_SIMD, R);
+	}
+}
+
+/*
+ * Computes BF_out for keys index to index + BF_SIMD - 1.
+ */
+static void BF_simd_crypt(BF_salt *salt, int index, struct BF_simd_ctx *ctx)
+{
+	const vtype mask = vset1_epi32(0xFF << BF_SIMD_SHIFT);
+	const vtype lane = vload(BF_simd_lanes);
+	vtype exp_key[BF_ROUNDS + 2], salt_w[4];
+	vtype L, R, tmp;
+	JTR_ALIGN(MEM_ALIGN_SIMD) BF_word out[6][BF_SIMD];
+	BF_word *ptr;
+	BF_word count;
+	int i, j;
+
+	for (i = 0; i < 4; i++)
+		salt_w[i] = vset1_epi32(salt->salt[i]);
+
+	for (i = 0; i < BF_ROUNDS + 2; i++) {
+		for (j = 0; j < BF_SIMD; j++) {
+			ctx->P[i][j] = BF_init_key[index + j][i];
+			out[0][j] = BF_exp_key[index + j][i];
+		}
+		exp_key[i] = vload(out[0]);
+	}
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 0x100; j++)
+			vstore(ctx->S[i][j], vset1_epi32(BF_init_state.S[i][j]));
+
+	L = R = vsetzero();
+	for (i = 0; i < BF_ROUNDS + 2; i += 2) {
+		L = vxor(L, salt_w[i & 2]);
+		R = vxor(R, salt_w[(i & 2) + 1]);
+		BF_SIMD_ENCRYPT(L, R);
+		vstore(ctx->P[i], L);
+		vstore(ctx->P[i + 1], R);
+	}
+	for (ptr = ctx->S[0][0]; ptr < ctx->S[3][0xFF]; ptr += 4 * BF_SIMD) {
+		L = vxor(L, salt_w[(BF_ROUNDS + 2) & 3]);
+		R = vxor(R, salt_w[(BF_ROUNDS + 3) & 3]);
+		BF_SIMD_ENCRYPT(L, R);
+		vstore(ptr, L);
+		vstore(ptr + BF_SIMD, R);
+
+		L = vxor(L, salt_w[(BF_ROUNDS + 4) & 3]);
+		R = vxor(R, salt_w[(BF_ROUNDS + 5) & 3]);
+		BF_SIMD_ENCRYPT(L, R);
+		vstore(ptr + 2 * BF_SIMD, L);
+		vstore(ptr + 3 * BF_SIMD, R);
+	}
+
+	count = 1 << salt->rounds;
+	do {
+		for (i = 0; i < BF_ROUNDS + 2; i++)
+			vstore(ctx->P[i], vxor(vload(ctx->P[i]), exp_key[i]));
+
+		BF_simd_body(ctx);
+
+		for (i = 0; i < BF_ROUNDS + 2; i++)
+			vstore(ctx->P[i], vxor(vload(ctx->P[i]), salt_w[i & 3]));
+
+		BF_simd_body(ctx);
+	} while (--count);
+
+	for (i = 0; i < 6; i += 2) {
+		L = vset1_epi32(BF_magic_w[i]);
+		R = vset1_epi32(BF_magic_w[i + 1]);
+		count = 64;
+		do {
+			BF_SIMD_ENCRYPT(L, R);
+		} while (--count);
+		vstore(out[i], L);
+		vstore(out[i + 1], R);
+	}
+
+	for (j = 0; j < BF_SIMD; j++) {
+		for (i = 0; i < 6; i++)
+			BF_out[index + j][i] = out[i][j];
+/* This has to be bug-compatible with the original implementation :-) */
+		BF_out[index + j][5] &= ~(BF_word)0xFF;
+	}
+}
+#endif
+
 void BF_std_set_key(char *key, int index, int sign_extension_bug) {
 	char *ptr = key;
 	int i, j;
@@ -386,6 +560,18 @@ void BF_std_crypt(BF_salt *salt, int n)
 	int t;
 #endif
 
+#if BF_SIMD
+	if (BF_use_simd) {
+#pragma omp parallel for
+		for (t = 0; t < n; t += BF_SIMD) {
+			JTR_ALIGN(MEM_ALIGN_SIMD) struct BF_simd_ctx ctx;
+
+			BF_simd_crypt(salt, t, &ctx);
+		}
+		return;
+	}
+#endif
+
 #if BF_mt > 1 && defined(_OPENMP)
 #if defined(WITH_UBSAN)
 #pragma omp parallel for
@@ -574,3 +760,35 @@ void BF_std_crypt_exact(int index)
 	BF_out[index][5] &= ~(BF_word)0xFF;
 }
 #endif
+
+#if BF_SIMD
+int BF_std_select(void)
+{
+	BF_salt salt;
+	uint64_t start, time, best[2] = { ~(uint64_t)0, ~(uint64_t)0 };
+	int i, n;
+
+/* A multiple of both BF_Nmin and BF_SIMD for every thread */
+	n = BF_Nmin * BF_SIMD * omp_get_max_threads();
+	while (n > BF_N)
+		n -= BF_Nmin * BF_SIMD;
+
+	for (i = 0; i < n; i++)
+		BF_std_set_key("password", i, 0);
+	memset(&salt, 0, sizeof(salt));
+	salt.rounds = 2;
+
+	for (i = 0; i < 4; i++) {
+		BF_use_simd = i & 1;
+		start = john_get_nano();
+		BF_std_crypt(&salt, n);
+		time = john_get_nano() - start;
+		if (time < best[BF_use_simd])
+			best[BF_use_simd] = time;
+	}
+
+	BF_use_simd = best[1] < best[0];
+
+	return BF_use_simd ? BF_SIMD : BF_Nmin;
+}
+#endif
@@ -39,6 +39,20 @@
 #define BF_N				BF_Nmin
 #endif
 
+/*
+ * Gather-based SIMD code running SIMD_COEF_32 independent EksBlowfish states
+ * per thread.  It is only used when BF_std_select() finds it to be faster.
+ */
+#if BF_mt > 1 && defined(__AVX512F__)
+#define BF_SIMD				16
+#define BF_SIMD_ALGORITHM_NAME		"Blowfish 512/512 AVX512F 16x"
+#elif BF_mt > 1 && defined(__AVX2__)
+#define BF_SIMD				8
+#define BF_SIMD_ALGORITHM_NAME		"Blowfish 256/256 AVX2 8x"
+#else
+#define BF_SIMD				0
+#endif
+
 /*
  * BF_std_crypt() output buffer.
  */
@@ -63,6 +77,15 @@ extern void BF_std_set_key(char *key, int index, int sign_extension_bug);
  */
 extern void BF_std_crypt(BF_salt *salt, int n);
 
+#if BF_SIMD
+/*
+ * Benchmarks the SIMD code against the scalar code, and makes BF_std_crypt()
+ * use the faster one from now on.  Returns the number of keys per thread it
+ * wants each call to be a multiple of: BF_SIMD or BF_Nmin.
+ */
+extern int BF_std_select(void);
+#endif
+
 #if BF_mt == 1
 /*
  * Calculates the rest of BF_out, for exact comparison.
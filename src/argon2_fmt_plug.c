@@ -37,7 +37,11 @@ john_register_one(&fmt_argon2);
 #if defined (JOHN_NO_SIMD)
 #define ALGORITHM_NAME          "Blake2"
 #else
-#if defined(__XOP__)
+#if defined(__AVX512F__)
+#define ALGORITHM_NAME          "Blake2 AVX512F"
+#elif defined(__AVX2__)
+#define ALGORITHM_NAME          "Blake2 AVX2"
+#elif defined(__XOP__)
 #define ALGORITHM_NAME          "Blake2 XOP"
 #elif defined(__AVX__)
 #define ALGORITHM_NAME          "Blake2 AVX"
@@ -153,10 +157,67 @@ static void print_memory(double memory)
 	fprintf(stderr, "memory per hash : %.2lf %cB\n", memory, s[i]);
 }
 
+/*
+ * Per-thread scratch arenas only ever grow.  reset() sizes them for the
+ * largest salt loaded, so set_salt() doesn't churn through mmap/munmap (and
+ * lose the huge pages) every time a bigger salt comes along.
+ */
+static void alloc_scratch(struct argon2_salt *salt)
+{
+	uint32_t i;
+	size_t mem_size;
+	uint32_t segment_length, memory_blocks;
+
+	mem_size=sizeof(block)*salt->m_cost;
+
+	memory_blocks = salt->m_cost;
+
+	if (memory_blocks < 2 * ARGON2_SYNC_POINTS * salt->lanes) {
+		memory_blocks = 2 * ARGON2_SYNC_POINTS * salt->lanes;
+	}
+
+	segment_length = memory_blocks / (salt->lanes * ARGON2_SYNC_POINTS);
+
+	if (mem_size>saved_mem_size)
+	{
+		if (saved_mem_size>0)
+			for (i=0;i<sc_threads;i++)
+				free_region_t(&memory[i]);
+		for (i=0;i<sc_threads;i++)
+			if (!alloc_region_t(&memory[i],mem_size)) {
+				fprintf(stderr, "Error: argon2 could not allocate %u KiB of memory\n",
+				        (unsigned int)(mem_size >> 10));
+				error();
+			}
+
+		saved_mem_size=mem_size;
+	}
+
+	if (segment_length>saved_segment_length)
+	{
+		if (saved_segment_length>0)
+			for (i=0;i<sc_threads;i++)
+				MEM_FREE(pseudo_rands[i]);
+		for (i=0;i<sc_threads;i++)
+			pseudo_rands[i]=mem_calloc(sizeof(uint64_t), segment_length);
+
+		saved_segment_length=segment_length;
+	}
+}
+
 static void reset(struct db_main *db)
 {
 	static int printed=0;
 
+	if (db) {
+		struct db_salt *salts = db->salts;
+
+		while (salts != NULL) {
+			alloc_scratch(salts->salt);
+			salts = salts->next;
+		}
+	}
+
 	if (!printed && options.verbosity > VERB_LEGACY)
 	{
 		int i;
@@ -288,43 +349,27 @@ static void *get_salt(char *ciphertext)
 
 static void set_salt(void *salt)
 {
-	uint32_t i;
-	size_t mem_size;
-	uint32_t segment_length, memory_blocks;
 	memcpy(&saved_salt,salt,sizeof(struct argon2_salt));
 
+	alloc_scratch(&saved_salt);
+}
 
-	mem_size=sizeof(block)*saved_salt.m_cost;
-
-	memory_blocks = saved_salt.m_cost;
-
-        if (memory_blocks < 2 * ARGON2_SYNC_POINTS * saved_salt.lanes) {
-           memory_blocks = 2 * ARGON2_SYNC_POINTS * saved_salt.lanes;
-        }
-
-	segment_length = memory_blocks / (saved_salt.lanes * ARGON2_SYNC_POINTS);
-
-	if (mem_size>saved_mem_size)
-	{
-		if (saved_mem_size>0)
-			for (i=0;i<sc_threads;i++)
-				free_region_t(&memory[i]);
-		for (i=0;i<sc_threads;i++)
-			alloc_region_t(&memory[i],mem_size);
-
-		saved_mem_size=mem_size;
-	}
-
-	if (segment_length>saved_segment_length)
-	{
-		if (saved_segment_length>0)
-			for (i=0;i<sc_threads;i++)
-				MEM_FREE(pseudo_rands[i]);
-		for (i=0;i<sc_threads;i++)
-			pseudo_rands[i]=mem_calloc(sizeof(uint64_t), segment_length);
-
-		saved_segment_length=segment_length;
-	}
+/*
+ * Order salts by cost, largest first, so that salts of equal cost are
+ * processed one after another.
+ */
+static int salt_compare(const void *x, const void *y)
+{
+	const struct argon2_salt *s1 = x;
+	const struct argon2_salt *s2 = y;
+
+	if (s1->m_cost != s2->m_cost)
+		return s1->m_cost > s2->m_cost ? -1 : 1;
+	if (s1->t_cost != s2->t_cost)
+		return s1->t_cost > s2->t_cost ? -1 : 1;
+	if (s1->lanes != s2->lanes)
+		return s1->lanes > s2->lanes ? -1 : 1;
+	return memcmp(s1, s2, sizeof(struct argon2_salt));
 }
 
 static int cmp_all(void *binary, int count)
@@ -469,7 +514,7 @@ struct fmt_main fmt_argon2 = {
 			fmt_default_binary_hash_6
 		},
 		salt_hash,
-		NULL,
+		salt_compare,
 		set_salt,
 		set_key,
 		get_key,
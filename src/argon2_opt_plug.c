@@ -22,6 +22,70 @@
 #include "blake2.h"
 #include "blamka-round-opt.h"
 
+#if defined(__AVX512F__)
+typedef __m512i argon2_vec;
+#define ARGON2_VECS_IN_BLOCK    (ARGON2_BLOCK_SIZE / 64)
+#define vec_load(p)             _mm512_loadu_si512((const void *)(p))
+#define vec_store(p, x)         _mm512_storeu_si512((void *)(p), (x))
+#define vec_xor(x, y)           _mm512_xor_si512((x), (y))
+#define BLAKE2_ROUNDS(state)                                                   \
+    do {                                                                       \
+        uint32_t i;                                                            \
+        for (i = 0; i < 2; ++i) {                                              \
+            BLAKE2_ROUND_1(state[8 * i + 0], state[8 * i + 1],                 \
+                state[8 * i + 2], state[8 * i + 3], state[8 * i + 4],          \
+                state[8 * i + 5], state[8 * i + 6], state[8 * i + 7]);         \
+        }                                                                      \
+        for (i = 0; i < 2; ++i) {                                              \
+            BLAKE2_ROUND_2(state[2 * 0 + i], state[2 * 1 + i],                 \
+                state[2 * 2 + i], state[2 * 3 + i], state[2 * 4 + i],          \
+                state[2 * 5 + i], state[2 * 6 + i], state[2 * 7 + i]);         \
+        }                                                                      \
+    } while ((void)0, 0)
+#elif defined(__AVX2__)
+typedef __m256i argon2_vec;
+#define ARGON2_VECS_IN_BLOCK    (ARGON2_BLOCK_SIZE / 32)
+#define vec_load(p)             _mm256_loadu_si256((__m256i const *)(p))
+#define vec_store(p, x)         _mm256_storeu_si256((__m256i *)(p), (x))
+#define vec_xor(x, y)           _mm256_xor_si256((x), (y))
+#define BLAKE2_ROUNDS(state)                                                   \
+    do {                                                                       \
+        uint32_t i;                                                            \
+        for (i = 0; i < 4; ++i) {                                              \
+            BLAKE2_ROUND_1(state[8 * i + 0], state[8 * i + 4],                 \
+                state[8 * i + 1], state[8 * i + 5], state[8 * i + 2],          \
+                state[8 * i + 6], state[8 * i + 3], state[8 * i + 7]);         \
+        }                                                                      \
+        for (i = 0; i < 4; ++i) {                                              \
+            BLAKE2_ROUND_2(state[0 + i], state[4 + i], state[8 + i],           \
+                state[12 + i], state[16 + i], state[20 + i], state[24 + i],    \
+                state[28 + i]);                                                \
+        }                                                                      \
+    } while ((void)0, 0)
+#else
+typedef __m128i argon2_vec;
+#define ARGON2_VECS_IN_BLOCK    ARGON2_OWORDS_IN_BLOCK
+#define vec_load(p)             _mm_loadu_si128((__m128i const *)(p))
+#define vec_store(p, x)         _mm_storeu_si128((__m128i *)(p), (x))
+#define vec_xor(x, y)           _mm_xor_si128((x), (y))
+#define BLAKE2_ROUNDS(state)                                                   \
+    do {                                                                       \
+        uint32_t i;                                                            \
+        for (i = 0; i < 8; ++i) {                                              \
+            BLAKE2_ROUND(state[8 * i + 0], state[8 * i + 1],                   \
+                state[8 * i + 2], state[8 * i + 3], state[8 * i + 4],          \
+                state[8 * i + 5], state[8 * i + 6], state[8 * i + 7]);         \
+        }                                                                      \
+        for (i = 0; i < 8; ++i) {                                              \
+            BLAKE2_ROUND(state[8 * 0 + i], state[8 * 1 + i],                   \
+                state[8 * 2 + i], state[8 * 3 + i], state[8 * 4 + i],          \
+                state[8 * 5 + i], state[8 * 6 + i], state[8 * 7 + i]);         \
+        }                                                                      \
+    } while ((void)0, 0)
+#endif
+
+#define ARGON2_VEC_SIZE         (ARGON2_BLOCK_SIZE / ARGON2_VECS_IN_BLOCK)
+
 /* LEGACY CODE: version 1.2.1 and earlier
 * Function fills a new memory block by overwriting @next_block.
 * @param state Pointer to the just produced block. Content will be updated(!)
@@ -29,30 +93,20 @@
 * @param next_block Pointer to the block to be XORed over. May coincide with @ref_block
 * @pre all block pointers must be valid
 */
-static void fill_block(__m128i *state, const uint8_t *ref_block, uint8_t *next_block) {
-    __m128i block_XY[ARGON2_OWORDS_IN_BLOCK];
+static void fill_block(argon2_vec *state, const uint8_t *ref_block, uint8_t *next_block) {
+    argon2_vec block_XY[ARGON2_VECS_IN_BLOCK];
     uint32_t i;
 
-    for (i = 0; i < ARGON2_OWORDS_IN_BLOCK; i++) {
-        block_XY[i] = state[i] = _mm_xor_si128(
-            state[i], _mm_loadu_si128((__m128i const *)(&ref_block[16 * i])));
-    }
-
-    for (i = 0; i < 8; ++i) {
-        BLAKE2_ROUND(state[8 * i + 0], state[8 * i + 1], state[8 * i + 2],
-            state[8 * i + 3], state[8 * i + 4], state[8 * i + 5],
-            state[8 * i + 6], state[8 * i + 7]);
+    for (i = 0; i < ARGON2_VECS_IN_BLOCK; i++) {
+        block_XY[i] = state[i] = vec_xor(
+            state[i], vec_load(&ref_block[ARGON2_VEC_SIZE * i]));
     }
 
-    for (i = 0; i < 8; ++i) {
-        BLAKE2_ROUND(state[8 * 0 + i], state[8 * 1 + i], state[8 * 2 + i],
-            state[8 * 3 + i], state[8 * 4 + i], state[8 * 5 + i],
-            state[8 * 6 + i], state[8 * 7 + i]);
-    }
+    BLAKE2_ROUNDS(state);
 
-    for (i = 0; i < ARGON2_OWORDS_IN_BLOCK; i++) {
-        state[i] = _mm_xor_si128(state[i], block_XY[i]);
-        _mm_storeu_si128((__m128i *)(&next_block[16 * i]), state[i]);
+    for (i = 0; i < ARGON2_VECS_IN_BLOCK; i++) {
+        state[i] = vec_xor(state[i], block_XY[i]);
+        vec_store(&next_block[ARGON2_VEC_SIZE * i], state[i]);
     }
 }
 
@@ -64,33 +118,23 @@ static void fill_block(__m128i *state, const uint8_t *ref_block, uint8_t *next_b
  * @param next_block Pointer to the block to be XORed over. May coincide with @ref_block
  * @pre all block pointers must be valid
  */
-static void fill_block_with_xor(__m128i *state, const uint8_t *ref_block,
+static void fill_block_with_xor(argon2_vec *state, const uint8_t *ref_block,
                          uint8_t *next_block) {
-    __m128i block_XY[ARGON2_OWORDS_IN_BLOCK];
+    argon2_vec block_XY[ARGON2_VECS_IN_BLOCK];
     uint32_t i;
 
-    for (i = 0; i < ARGON2_OWORDS_IN_BLOCK; i++) {
-       state[i] = _mm_xor_si128(
-            state[i], _mm_loadu_si128((__m128i const *)(&ref_block[16 * i])));
-        block_XY[i] =  _mm_xor_si128(
-            state[i], _mm_loadu_si128((__m128i const *)(&next_block[16 * i])));
+    for (i = 0; i < ARGON2_VECS_IN_BLOCK; i++) {
+        state[i] = vec_xor(
+            state[i], vec_load(&ref_block[ARGON2_VEC_SIZE * i]));
+        block_XY[i] = vec_xor(
+            state[i], vec_load(&next_block[ARGON2_VEC_SIZE * i]));
     }
 
-    for (i = 0; i < 8; ++i) {
-        BLAKE2_ROUND(state[8 * i + 0], state[8 * i + 1], state[8 * i + 2],
-                     state[8 * i + 3], state[8 * i + 4], state[8 * i + 5],
-                     state[8 * i + 6], state[8 * i + 7]);
-    }
-
-    for (i = 0; i < 8; ++i) {
-        BLAKE2_ROUND(state[8 * 0 + i], state[8 * 1 + i], state[8 * 2 + i],
-                     state[8 * 3 + i], state[8 * 4 + i], state[8 * 5 + i],
-                     state[8 * 6 + i], state[8 * 7 + i]);
-    }
+    BLAKE2_ROUNDS(state);
 
-    for (i = 0; i < ARGON2_OWORDS_IN_BLOCK; i++) {
-        state[i] = _mm_xor_si128(state[i], block_XY[i]);
-        _mm_storeu_si128((__m128i *)(&next_block[16 * i]), state[i]);
+    for (i = 0; i < ARGON2_VECS_IN_BLOCK; i++) {
+        state[i] = vec_xor(state[i], block_XY[i]);
+        vec_store(&next_block[ARGON2_VEC_SIZE * i], state[i]);
     }
 }
 
@@ -122,8 +166,8 @@ static void generate_addresses(const argon2_instance_t *instance,
         for (i = 0; i < instance->segment_length; ++i) {
             if (i % ARGON2_ADDRESSES_IN_BLOCK == 0) {
                 /*Temporary zero-initialized blocks*/
-                __m128i zero_block[ARGON2_OWORDS_IN_BLOCK];
-                __m128i zero2_block[ARGON2_OWORDS_IN_BLOCK];
+                argon2_vec zero_block[ARGON2_VECS_IN_BLOCK];
+                argon2_vec zero2_block[ARGON2_VECS_IN_BLOCK];
                 memset(zero_block, 0, sizeof(zero_block));
                 memset(zero2_block, 0, sizeof(zero2_block));
                 argon2_init_block_value(&address_block, 0);
@@ -149,7 +193,7 @@ void argon2_fill_segment(const argon2_instance_t *instance,
     uint64_t pseudo_rand, ref_index, ref_lane;
     uint32_t prev_offset, curr_offset;
     uint32_t starting_index, i;
-    __m128i state[64];
+    argon2_vec state[ARGON2_VECS_IN_BLOCK];
     int data_independent_addressing;
 
     /* Pseudo-random values that determine the reference block position */
@@ -67,7 +67,7 @@ static void _ldr_init_database(struct db_main *db) {
 	db->real = db;
 	db->pw_size = sizeof(struct db_password);
 	db->salt_size = sizeof(struct db_salt);
-	db->pw_size -= sizeof(struct list_main *);
+	db->pw_size -= sizeof(struct list_main *) + sizeof(char *);
 	db->pw_size -= sizeof(char *) * 2;
 	db->salt_size -= sizeof(struct db_keys *);
 	db->options = mem_calloc(sizeof(struct db_options), 1);
@@ -38,6 +38,7 @@ john_register_one(&fmt_bitlocker);
 #include "aes.h"
 #include "aes_ccm.h"
 #include "sha2.h"
+#include "simd-intrinsics.h"
 #include "jumbo.h"
 #include "bitlocker_common.h"
 #define CPU_FORMAT              1
@@ -48,7 +49,7 @@ john_register_one(&fmt_bitlocker);
 #endif
 
 #define FORMAT_LABEL            "BitLocker"
-#define ALGORITHM_NAME          "SHA-256 AES 32/" ARCH_BITS_STR
+#define ALGORITHM_NAME          "SHA-256 AES " SHA256_ALGORITHM_NAME
 #define BENCHMARK_COMMENT       ""
 #define BENCHMARK_LENGTH        0x107
 #define BINARY_SIZE             0
@@ -56,8 +57,13 @@ john_register_one(&fmt_bitlocker);
 #define SALT_SIZE               sizeof(*cur_salt)
 #define BINARY_ALIGN            1
 #define SALT_ALIGN              sizeof(int)
+#ifdef SIMD_COEF_32
+#define MIN_KEYS_PER_CRYPT      (SIMD_COEF_32 * SIMD_PARA_SHA256)
+#define MAX_KEYS_PER_CRYPT      (SIMD_COEF_32 * SIMD_PARA_SHA256)
+#else
 #define MIN_KEYS_PER_CRYPT      1
 #define MAX_KEYS_PER_CRYPT      1
+#endif
 
 static UTF16 (*saved_key)[PLAINTEXT_LENGTH + 1];
 static int *cracked, cracked_count;
@@ -108,6 +114,72 @@ struct libbde_password_key_data
         uint64_t iteration_count;
 };
 
+#ifdef SIMD_COEF_32
+/* Index of 32-bit word w of candidate i in a mixed (interleaved) SIMD buffer */
+#define MIXED_POS(i, w)  (((i) / SIMD_COEF_32) * SIMD_COEF_32 * 16 + \
+                          (w) * SIMD_COEF_32 + ((i) & (SIMD_COEF_32 - 1)))
+
+static uint32_t load_be32(const unsigned char *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+		(uint32_t)p[2] << 8 | p[3];
+}
+
+/*
+ * Same as below, for MAX_KEYS_PER_CRYPT candidates at once.  The 88 bytes
+ * hashed per iteration are two SHA-256 blocks: the first is the last and
+ * the initial hash, the second is salt, iteration count and padding.  Only
+ * the first half of block one and the counter in block two change, and the
+ * second compression writes its result straight back into block one.
+ */
+static void bitlocker_kdf(unsigned char (*password_hash)[32],
+                          unsigned char (*out)[32])
+{
+	JTR_ALIGN(MEM_ALIGN_SIMD) uint32_t block1[MAX_KEYS_PER_CRYPT * 16];
+	JTR_ALIGN(MEM_ALIGN_SIMD) uint32_t block2[MAX_KEYS_PER_CRYPT * 16];
+	JTR_ALIGN(MEM_ALIGN_SIMD) uint32_t state[MAX_KEYS_PER_CRYPT * 8];
+	unsigned char salt[16] = { 0 };
+	uint32_t ic;
+	int i, w;
+
+	memcpy(salt, cur_salt->salt, cur_salt->salt_length);
+
+	for (i = 0; i < MAX_KEYS_PER_CRYPT; i++) {
+		for (w = 0; w < 8; w++) {
+			block1[MIXED_POS(i, w)] = 0;
+			block1[MIXED_POS(i, w + 8)] = load_be32(&password_hash[i][4 * w]);
+		}
+		for (w = 0; w < 4; w++)
+			block2[MIXED_POS(i, w)] = load_be32(&salt[4 * w]);
+		for (w = 4; w < 15; w++)
+			block2[MIXED_POS(i, w)] = 0;
+		block2[MIXED_POS(i, 6)] = 0x80000000;
+		block2[MIXED_POS(i, 15)] = sizeof(struct libbde_password_key_data) << 3;
+	}
+
+	for (ic = 0; ic < cur_salt->iterations; ic++) {
+		/* 64-bit little-endian counter; the high word stays zero */
+		uint32_t ic_be = JOHNSWAP(ic);
+
+		for (i = 0; i < MAX_KEYS_PER_CRYPT; i++)
+			block2[MIXED_POS(i, 4)] = ic_be;
+
+		SIMDSHA256body(block1, state, NULL, SSEi_MIXED_IN);
+		SIMDSHA256body(block2, block1, state,
+		               SSEi_MIXED_IN | SSEi_RELOAD | SSEi_OUTPUT_AS_INP_FMT);
+	}
+
+	for (i = 0; i < MAX_KEYS_PER_CRYPT; i++)
+		for (w = 0; w < 8; w++) {
+			uint32_t v = block1[MIXED_POS(i, w)];
+
+			out[i][4 * w] = v >> 24;
+			out[i][4 * w + 1] = v >> 16;
+			out[i][4 * w + 2] = v >> 8;
+			out[i][4 * w + 3] = v;
+		}
+}
+#else
 // derived from libbde's libbde_password_calculate_key
 static void bitlocker_kdf(unsigned char *password_hash, unsigned char *out)
 {
@@ -132,6 +204,7 @@ static void bitlocker_kdf(unsigned char *password_hash, unsigned char *out)
 
 	memcpy(out, pkd.last_sha256_hash, 32); // this is the aes-ccm key
 }
+#endif
 
 #ifdef BITLOCKER_DEBUG
 static void print_hex(unsigned char *str, int len)
@@ -174,8 +247,14 @@ static int crypt_all(int *pcount, struct db_salt *salt)
 			SHA256_Init(&ctx);
 			SHA256_Update(&ctx, out[i], 32);
 			SHA256_Final(out[i], &ctx);
-			// run bitlocker kdf
-			bitlocker_kdf(out[i], out[i]);
+		}
+		// run bitlocker kdf
+#ifdef SIMD_COEF_32
+		bitlocker_kdf(out, out);
+#else
+		bitlocker_kdf(out[0], out[0]);
+#endif
+		for (i = 0; i < MAX_KEYS_PER_CRYPT; ++i) {
 			libcaes_crypt_ccm(out[i], 256, 0, cur_salt->iv, IVLEN, // 0 -> decrypt mode
 					cur_salt->data, cur_salt->data_size,
 					output, cur_salt->data_size);
@@ -3,6 +3,310 @@
 
 #include "blake2-impl.h"
 
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+/*
+ * A 512-bit register holds two independent 4-word BLAKE2b rows, one per
+ * 256-bit half, so each G below works on four BLAKE2b states at once.
+ */
+inline static __m512i fBlaMka(__m512i x, __m512i y) {
+    const __m512i z = _mm512_mul_epu32(x, y);
+    return _mm512_add_epi64(_mm512_add_epi64(x, y), _mm512_add_epi64(z, z));
+}
+
+#define G1(A0, B0, C0, D0, A1, B1, C1, D1)                                     \
+    do {                                                                       \
+        A0 = fBlaMka(A0, B0);                                                  \
+        A1 = fBlaMka(A1, B1);                                                  \
+                                                                               \
+        D0 = _mm512_xor_si512(D0, A0);                                         \
+        D1 = _mm512_xor_si512(D1, A1);                                         \
+                                                                               \
+        D0 = _mm512_ror_epi64(D0, 32);                                         \
+        D1 = _mm512_ror_epi64(D1, 32);                                         \
+                                                                               \
+        C0 = fBlaMka(C0, D0);                                                  \
+        C1 = fBlaMka(C1, D1);                                                  \
+                                                                               \
+        B0 = _mm512_xor_si512(B0, C0);                                         \
+        B1 = _mm512_xor_si512(B1, C1);                                         \
+                                                                               \
+        B0 = _mm512_ror_epi64(B0, 24);                                         \
+        B1 = _mm512_ror_epi64(B1, 24);                                         \
+    } while ((void)0, 0)
+
+#define G2(A0, B0, C0, D0, A1, B1, C1, D1)                                     \
+    do {                                                                       \
+        A0 = fBlaMka(A0, B0);                                                  \
+        A1 = fBlaMka(A1, B1);                                                  \
+                                                                               \
+        D0 = _mm512_xor_si512(D0, A0);                                         \
+        D1 = _mm512_xor_si512(D1, A1);                                         \
+                                                                               \
+        D0 = _mm512_ror_epi64(D0, 16);                                         \
+        D1 = _mm512_ror_epi64(D1, 16);                                         \
+                                                                               \
+        C0 = fBlaMka(C0, D0);                                                  \
+        C1 = fBlaMka(C1, D1);                                                  \
+                                                                               \
+        B0 = _mm512_xor_si512(B0, C0);                                         \
+        B1 = _mm512_xor_si512(B1, C1);                                         \
+                                                                               \
+        B0 = _mm512_ror_epi64(B0, 63);                                         \
+        B1 = _mm512_ror_epi64(B1, 63);                                         \
+    } while ((void)0, 0)
+
+#define DIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1)                            \
+    do {                                                                       \
+        B0 = _mm512_permutex_epi64(B0, _MM_SHUFFLE(0, 3, 2, 1));               \
+        B1 = _mm512_permutex_epi64(B1, _MM_SHUFFLE(0, 3, 2, 1));               \
+                                                                               \
+        C0 = _mm512_permutex_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));               \
+        C1 = _mm512_permutex_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));               \
+                                                                               \
+        D0 = _mm512_permutex_epi64(D0, _MM_SHUFFLE(2, 1, 0, 3));               \
+        D1 = _mm512_permutex_epi64(D1, _MM_SHUFFLE(2, 1, 0, 3));               \
+    } while ((void)0, 0)
+
+#define UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1)                          \
+    do {                                                                       \
+        B0 = _mm512_permutex_epi64(B0, _MM_SHUFFLE(2, 1, 0, 3));               \
+        B1 = _mm512_permutex_epi64(B1, _MM_SHUFFLE(2, 1, 0, 3));               \
+                                                                               \
+        C0 = _mm512_permutex_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));               \
+        C1 = _mm512_permutex_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));               \
+                                                                               \
+        D0 = _mm512_permutex_epi64(D0, _MM_SHUFFLE(0, 3, 2, 1));               \
+        D1 = _mm512_permutex_epi64(D1, _MM_SHUFFLE(0, 3, 2, 1));               \
+    } while ((void)0, 0)
+
+#define BLAKE2_ROUND(A0, B0, C0, D0, A1, B1, C1, D1)                           \
+    do {                                                                       \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+                                                                               \
+        DIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1);                           \
+                                                                               \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+                                                                               \
+        UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1);                         \
+    } while ((void)0, 0)
+
+/* (A0, A1) -> (A0.lo:A1.lo, A0.hi:A1.hi), in 256-bit halves; an involution */
+#define SWAP_HALVES(A0, A1)                                                    \
+    do {                                                                       \
+        __m512i t0, t1;                                                        \
+        t0 = _mm512_shuffle_i64x2(A0, A1, _MM_SHUFFLE(1, 0, 1, 0));            \
+        t1 = _mm512_shuffle_i64x2(A0, A1, _MM_SHUFFLE(3, 2, 3, 2));            \
+        A0 = t0;                                                               \
+        A1 = t1;                                                               \
+    } while ((void)0, 0)
+
+#define SWAP_QUARTERS(A0, A1)                                                  \
+    do {                                                                       \
+        SWAP_HALVES(A0, A1);                                                   \
+        A0 = _mm512_permutexvar_epi64(                                         \
+            _mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A0);                    \
+        A1 = _mm512_permutexvar_epi64(                                         \
+            _mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A1);                    \
+    } while ((void)0, 0)
+
+#define UNSWAP_QUARTERS(A0, A1)                                                \
+    do {                                                                       \
+        A0 = _mm512_permutexvar_epi64(                                         \
+            _mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A0);                    \
+        A1 = _mm512_permutexvar_epi64(                                         \
+            _mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7), A1);                    \
+        SWAP_HALVES(A0, A1);                                                   \
+    } while ((void)0, 0)
+
+/* Four consecutive 16-word rows of the block, two registers each */
+#define BLAKE2_ROUND_1(A0, C0, B0, D0, A1, C1, B1, D1)                         \
+    do {                                                                       \
+        SWAP_HALVES(A0, B0);                                                   \
+        SWAP_HALVES(C0, D0);                                                   \
+        SWAP_HALVES(A1, B1);                                                   \
+        SWAP_HALVES(C1, D1);                                                   \
+        BLAKE2_ROUND(A0, B0, C0, D0, A1, B1, C1, D1);                          \
+        SWAP_HALVES(A0, B0);                                                   \
+        SWAP_HALVES(C0, D0);                                                   \
+        SWAP_HALVES(A1, B1);                                                   \
+        SWAP_HALVES(C1, D1);                                                   \
+    } while ((void)0, 0)
+
+/* Four 2-word columns of the block, one register per row */
+#define BLAKE2_ROUND_2(A0, A1, B0, B1, C0, C1, D0, D1)                         \
+    do {                                                                       \
+        SWAP_QUARTERS(A0, A1);                                                 \
+        SWAP_QUARTERS(B0, B1);                                                 \
+        SWAP_QUARTERS(C0, C1);                                                 \
+        SWAP_QUARTERS(D0, D1);                                                 \
+        BLAKE2_ROUND(A0, B0, C0, D0, A1, B1, C1, D1);                          \
+        UNSWAP_QUARTERS(A0, A1);                                               \
+        UNSWAP_QUARTERS(B0, B1);                                               \
+        UNSWAP_QUARTERS(C0, C1);                                               \
+        UNSWAP_QUARTERS(D0, D1);                                               \
+    } while ((void)0, 0)
+
+#elif defined(__AVX2__)
+#include <immintrin.h>
+
+/*
+ * A 256-bit register holds a whole 4-word BLAKE2b row, so each G below
+ * works on two BLAKE2b states at once.
+ */
+#define rotr32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define rotr24(x)                                                              \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(                                 \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,                  \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define rotr16(x)                                                              \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(                                 \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,                  \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define rotr63(x)                                                              \
+    _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+inline static __m256i fBlaMka(__m256i x, __m256i y) {
+    const __m256i z = _mm256_mul_epu32(x, y);
+    return _mm256_add_epi64(_mm256_add_epi64(x, y), _mm256_add_epi64(z, z));
+}
+
+#define G1(A0, B0, C0, D0, A1, B1, C1, D1)                                     \
+    do {                                                                       \
+        A0 = fBlaMka(A0, B0);                                                  \
+        A1 = fBlaMka(A1, B1);                                                  \
+                                                                               \
+        D0 = _mm256_xor_si256(D0, A0);                                         \
+        D1 = _mm256_xor_si256(D1, A1);                                         \
+                                                                               \
+        D0 = rotr32(D0);                                                       \
+        D1 = rotr32(D1);                                                       \
+                                                                               \
+        C0 = fBlaMka(C0, D0);                                                  \
+        C1 = fBlaMka(C1, D1);                                                  \
+                                                                               \
+        B0 = _mm256_xor_si256(B0, C0);                                         \
+        B1 = _mm256_xor_si256(B1, C1);                                         \
+                                                                               \
+        B0 = rotr24(B0);                                                       \
+        B1 = rotr24(B1);                                                       \
+    } while ((void)0, 0)
+
+#define G2(A0, B0, C0, D0, A1, B1, C1, D1)                                     \
+    do {                                                                       \
+        A0 = fBlaMka(A0, B0);                                                  \
+        A1 = fBlaMka(A1, B1);                                                  \
+                                                                               \
+        D0 = _mm256_xor_si256(D0, A0);                                         \
+        D1 = _mm256_xor_si256(D1, A1);                                         \
+                                                                               \
+        D0 = rotr16(D0);                                                       \
+        D1 = rotr16(D1);                                                       \
+                                                                               \
+        C0 = fBlaMka(C0, D0);                                                  \
+        C1 = fBlaMka(C1, D1);                                                  \
+                                                                               \
+        B0 = _mm256_xor_si256(B0, C0);                                         \
+        B1 = _mm256_xor_si256(B1, C1);                                         \
+                                                                               \
+        B0 = rotr63(B0);                                                       \
+        B1 = rotr63(B1);                                                       \
+    } while ((void)0, 0)
+
+/* Whole rows: rotate b, c and d left by one, two and three words */
+#define DIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1)                          \
+    do {                                                                       \
+        B0 = _mm256_permute4x64_epi64(B0, _MM_SHUFFLE(0, 3, 2, 1));            \
+        C0 = _mm256_permute4x64_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));            \
+        D0 = _mm256_permute4x64_epi64(D0, _MM_SHUFFLE(2, 1, 0, 3));            \
+                                                                               \
+        B1 = _mm256_permute4x64_epi64(B1, _MM_SHUFFLE(0, 3, 2, 1));            \
+        C1 = _mm256_permute4x64_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));            \
+        D1 = _mm256_permute4x64_epi64(D1, _MM_SHUFFLE(2, 1, 0, 3));            \
+    } while ((void)0, 0)
+
+#define UNDIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1)                        \
+    do {                                                                       \
+        B0 = _mm256_permute4x64_epi64(B0, _MM_SHUFFLE(2, 1, 0, 3));            \
+        C0 = _mm256_permute4x64_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));            \
+        D0 = _mm256_permute4x64_epi64(D0, _MM_SHUFFLE(0, 3, 2, 1));            \
+                                                                               \
+        B1 = _mm256_permute4x64_epi64(B1, _MM_SHUFFLE(2, 1, 0, 3));            \
+        C1 = _mm256_permute4x64_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));            \
+        D1 = _mm256_permute4x64_epi64(D1, _MM_SHUFFLE(0, 3, 2, 1));            \
+    } while ((void)0, 0)
+
+/*
+ * Half rows of two interleaved states per register pair: X0 holds words
+ * 0-1 and X1 words 2-3 of each state's row.
+ */
+#define DIAGONALIZE_2(A0, B0, C0, D0, A1, B1, C1, D1)                          \
+    do {                                                                       \
+        __m256i t0 = _mm256_blend_epi32(B0, B1, 0xCC);                         \
+        __m256i t1 = _mm256_blend_epi32(B0, B1, 0x33);                         \
+        B1 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1));            \
+        B0 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));            \
+                                                                               \
+        t0 = C0;                                                               \
+        C0 = C1;                                                               \
+        C1 = t0;                                                               \
+                                                                               \
+        t0 = _mm256_blend_epi32(D0, D1, 0xCC);                                 \
+        t1 = _mm256_blend_epi32(D0, D1, 0x33);                                 \
+        D0 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1));            \
+        D1 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));            \
+    } while ((void)0, 0)
+
+#define UNDIAGONALIZE_2(A0, B0, C0, D0, A1, B1, C1, D1)                        \
+    do {                                                                       \
+        __m256i t0 = _mm256_blend_epi32(B0, B1, 0xCC);                         \
+        __m256i t1 = _mm256_blend_epi32(B0, B1, 0x33);                         \
+        B0 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1));            \
+        B1 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));            \
+                                                                               \
+        t0 = C0;                                                               \
+        C0 = C1;                                                               \
+        C1 = t0;                                                               \
+                                                                               \
+        t0 = _mm256_blend_epi32(D0, D1, 0x33);                                 \
+        t1 = _mm256_blend_epi32(D0, D1, 0xCC);                                 \
+        D0 = _mm256_permute4x64_epi64(t0, _MM_SHUFFLE(2, 3, 0, 1));            \
+        D1 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));            \
+    } while ((void)0, 0)
+
+/* Two consecutive 16-word rows of the block, one register per quarter */
+#define BLAKE2_ROUND_1(A0, A1, B0, B1, C0, C1, D0, D1)                         \
+    do {                                                                       \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+                                                                               \
+        DIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1);                         \
+                                                                               \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+                                                                               \
+        UNDIAGONALIZE_1(A0, B0, C0, D0, A1, B1, C1, D1);                       \
+    } while ((void)0, 0)
+
+/* Two 2-word columns of the block, one register per row */
+#define BLAKE2_ROUND_2(A0, A1, B0, B1, C0, C1, D0, D1)                         \
+    do {                                                                       \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+                                                                               \
+        DIAGONALIZE_2(A0, B0, C0, D0, A1, B1, C1, D1);                         \
+                                                                               \
+        G1(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+        G2(A0, B0, C0, D0, A1, B1, C1, D1);                                    \
+                                                                               \
+        UNDIAGONALIZE_2(A0, B0, C0, D0, A1, B1, C1, D1);                       \
+    } while ((void)0, 0)
+
+#else /* SSE2 and up */
+
 #include <emmintrin.h>
 #if defined(__SSSE3__)
 #include <tmmintrin.h> /* for _mm_shuffle_epi8 and _mm_alignr_epi8 */
@@ -160,4 +464,6 @@ inline static __m128i fBlaMka(__m128i x, __m128i y) {
         UNDIAGONALIZE(A0, B0, C0, D0, A1, B1, C1, D1);                         \
     } while ((void)0, 0)
 
+#endif /* __AVX512F__, __AVX2__, SSE2 */
+
 #endif
@@ -208,6 +208,29 @@ static int cmp_count(const void *p1, const void *p2)
 	return c1->index - c2->index;
 }
 
+/*
+ * Pack the strings of one length into a contiguous array of character indices,
+ * so that the per-position passes below walk memory sequentially rather than
+ * chase list pointers.
+ */
+static unsigned char *charset_pack_list(struct list_main *list, int length)
+{
+	struct list_entry *current;
+	unsigned char *packed, *dst;
+
+	dst = packed = mem_alloc((size_t)list->count * (length + 1));
+
+	if ((current = list->head))
+	do {
+		unsigned char *ptr = (unsigned char *)current->data;
+		int pos;
+		for (pos = 0; pos <= length; pos++)
+			*dst++ = ARCH_INDEX(ptr[pos] - CHARSET_MIN);
+	} while ((current = current->next));
+
+	return packed;
+}
+
 static void charset_generate_chars(struct list_main **lists,
 	FILE *file, struct charset_header *header,
 	char_counters chars, crack_counters cracks)
@@ -217,11 +240,19 @@ static void charset_generate_chars(struct list_main **lists,
 	count_sort_t iv[CHARSET_SIZE];
 	int length, pos, count;
 	int i, j, k;
+	unsigned char (*used)[CHARSET_SIZE + 1];
+	unsigned char *packed;
 
 	memset(cracks, 0, sizeof(*cracks));
 
-/* Zeroize the same portion of "chars" as is used by the loop below */
-	memset((*chars)[0][0], 0, sizeof((*chars)[0][0]));
+/*
+ * "chars" is zeroized just once here.  Afterwards, we keep track of which of
+ * its rows we've touched and only zeroize those, as most of the table stays
+ * unused and clearing or scanning all of it for every position would take
+ * most of the time.
+ */
+	memset(chars, 0, sizeof(*chars));
+	used = mem_calloc(CHARSET_SIZE + 1, sizeof(*used));
 
 	for (length = 0; length <= CHARSET_LENGTH; length++) {
 		if ((current = lists[length]->head))
@@ -243,6 +274,8 @@ static void charset_generate_chars(struct list_main **lists,
 		}
 	}
 
+	memset((*chars)[0][0], 0, sizeof((*chars)[0][0]));
+
 	if (count > 1)
 		qsort(iv, count, sizeof(iv[0]), cmp_count);
 
@@ -253,56 +286,60 @@ static void charset_generate_chars(struct list_main **lists,
 	fwrite(buffer, 1, count, file);
 	CRC32_Update(&checksum, buffer, count);
 
+	packed = NULL;
 	for (length = 0; charset_new_length(length, header, file); length++)
 	for (pos = 0; pos <= length; pos++) {
+		unsigned char *ptr, *end;
+
 		if (event_abort)
-			return;
+			goto out;
 
-		if (!(current = lists[length]->head))
+		if (!lists[length]->count)
 			continue;
 
+		if (!pos) {
+			MEM_FREE(packed);
+			packed = charset_pack_list(lists[length], length);
+		}
+
+		ptr = packed;
+		end = packed + (size_t)lists[length]->count * (length + 1);
 		switch (pos) {
 		case 0:
-			memset((*chars)[CHARSET_SIZE][CHARSET_SIZE], 0,
-			    sizeof((*chars)[CHARSET_SIZE][CHARSET_SIZE]));
-			do {
-				unsigned char *ptr =
-				    (unsigned char *)current->data;
-				int c = ARCH_INDEX(ptr[0] - CHARSET_MIN);
-				(*chars)[CHARSET_SIZE][CHARSET_SIZE][c]++;
-			} while ((current = current->next));
+			for (; ptr < end; ptr += length + 1)
+				(*chars)[CHARSET_SIZE][CHARSET_SIZE][ptr[0]]++;
 			break;
 		case 1:
-			memset((*chars)[CHARSET_SIZE], 0,
-			    sizeof((*chars)[CHARSET_SIZE]));
-			do {
-				unsigned char *ptr =
-				    (unsigned char *)current->data;
-				int b = ARCH_INDEX(ptr[0] - CHARSET_MIN);
-				int c = ARCH_INDEX(ptr[1] - CHARSET_MIN);
+			for (; ptr < end; ptr += length + 1) {
+				int b = ptr[0];
+				int c = ptr[1];
 				(*chars)[CHARSET_SIZE][b][c]++;
 				(*chars)[CHARSET_SIZE][CHARSET_SIZE][c]++;
-			} while ((current = current->next));
+				used[CHARSET_SIZE][b] = 1;
+			}
 			break;
 		default:
-			memset(chars, 0, sizeof(*chars));
-			do {
-				unsigned char *ptr =
-				    (unsigned char *)current->data;
-				int a = ARCH_INDEX(ptr[pos - 2] - CHARSET_MIN);
-				int b = ARCH_INDEX(ptr[pos - 1] - CHARSET_MIN);
-				int c = ARCH_INDEX(ptr[pos] - CHARSET_MIN);
+			for (ptr += pos - 2; ptr < end; ptr += length + 1) {
+				int a = ptr[0];
+				int b = ptr[1];
+				int c = ptr[2];
 				(*chars)[a][b][c]++;
 				(*chars)[CHARSET_SIZE][b][c]++;
 				(*chars)[CHARSET_SIZE][CHARSET_SIZE][c]++;
-			} while ((current = current->next));
+				used[a][b] = used[CHARSET_SIZE][b] = 1;
+			}
 		}
+		used[CHARSET_SIZE][CHARSET_SIZE] = 1;
 
 		cfputc(CHARSET_ESC, file); cfputc(CHARSET_NEW, file);
 		cfputc(length, file); cfputc(pos, file);
 
 		for (i = (pos > 1 ? 0 : CHARSET_SIZE); i <= CHARSET_SIZE; i++)
 		for (j = (pos ? 0 : CHARSET_SIZE); j <= CHARSET_SIZE; j++) {
+			if (!used[i][j])
+				continue;
+			used[i][j] = 0;
+
 			count = 0;
 			for (k = 0; k < CHARSET_SIZE; k++) {
 				unsigned int value = (*chars)[i][j][k];
@@ -312,6 +349,8 @@ static void charset_generate_chars(struct list_main **lists,
 				}
 			}
 
+			memset((*chars)[i][j], 0, sizeof((*chars)[i][j]));
+
 			if (!count)
 				continue;
 
@@ -334,6 +373,10 @@ static void charset_generate_chars(struct list_main **lists,
 
 	cfputc(CHARSET_ESC, file); cfputc(CHARSET_NEW, file);
 	cfputc(CHARSET_LENGTH, file);
+
+out:
+	MEM_FREE(packed);
+	MEM_FREE(used);
 }
 
 static double powi(int x, unsigned int y)
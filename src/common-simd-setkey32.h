@@ -72,6 +72,11 @@
  *        In a non-simd mode, there is only 1 saved_key variable (not
  *        an array of them).
  *
+ * SET_KEY_DELTA          Simple define
+ *        Also build a set_key_delta() function, for the format's methods.
+ *        In simd code, it copies the previous key's buffer words and only
+ *        patches the changed byte.  Non-simd code simply calls set_key().
+ *
  */
 
 #if defined(SIMD_COEF_32)
@@ -212,6 +217,25 @@ key_cleaning:
 #	endif
 #endif
 }
+
+#if defined(SET_KEY_DELTA)
+static void set_key_delta(char *key, int pos, int index)
+{
+	unsigned int prev = index - 1;
+	uint32_t *src = &((uint32_t*)saved_key)[GETPOSW32(0,prev)];
+	uint32_t *dst = &((uint32_t*)saved_key)[GETPOSW32(0,index)];
+	unsigned int i;
+
+	for (i = 0; i < 16 * SIMD_COEF_32; i += SIMD_COEF_32)
+		dst[i] = src[i];
+#if defined(SET_SAVED_LEN)
+	saved_len[index] = saved_len[index - 1];
+#endif
+
+	if (pos < PLAINTEXT_LENGTH)
+		((unsigned char*)saved_key)[GETPOS(pos + SALT_PREPENDED, index)] = key[pos];
+}
+#endif
 #else	// !defined SIMD_COEF_32
 static void set_key(char *key, int index)
 {
@@ -227,6 +251,13 @@ static void set_key(char *key, int index)
 	strnzcpyn(saved_key[index], key, sizeof(*saved_key));
 #endif
 }
+
+#if defined(SET_KEY_DELTA)
+static void set_key_delta(char *key, int pos, int index)
+{
+	set_key(key, index);
+}
+#endif
 #endif  // SIMD_COEF_32
 
 #if defined(SIMD_COEF_32)
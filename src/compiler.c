@@ -22,6 +22,28 @@
 
 #undef PRINT_INSNS
 
+/*
+ * Translate compiled programs to native code where we know how to.  The
+ * interpreter below remains in use wherever this isn't enabled or fails.
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__ILP32__) && \
+    defined(__unix__) && !defined(PRINT_INSNS)
+#define C_JIT				1
+#include <sys/mman.h>
+#else
+#define C_JIT				0
+#endif
+
+/*
+ * Separate instances of a compiled program need an interpreter that keeps its
+ * state on the (C) stack, which is the computed goto one only.
+ */
+#if defined(__GNUC__) && !defined(PRINT_INSNS)
+#define C_INSTANCES			1
+#else
+#define C_INSTANCES			0
+#endif
+
 char *c_errors[] = {
 	NULL,	/* No error */
 	"Unknown identifier",
@@ -72,6 +94,7 @@ static union c_insn *c_loop_start;
 static struct c_fixup *c_break_fixups = NULL;
 
 static struct c_ident *c_funcs = NULL;
+static struct c_ident *c_externs;
 
 static char c_unget_buffer[C_UNGET_SIZE];
 static int c_unget_count;
@@ -116,15 +139,46 @@ struct c_op {
 static struct c_op c_ops[];
 #ifndef PRINT_INSNS
 static int c_ops_initialized = 0;
+
+static void c_run(union c_insn *pc, union c_insn *stack);
 #endif
 #else
 #ifdef PRINT_INSNS
-static struct c_op c_ops[52];
+static struct c_op c_ops[59];
 #else
 static struct c_op c_ops[38];
 #endif
 #endif
 
+#if C_JIT
+/*
+ * Native code for one copy of the program's code, using one stack.
+ */
+struct c_jit {
+	union c_insn *start, *end;
+	union c_insn *stack;
+	unsigned char *code;
+	size_t size;
+	unsigned int *map;
+};
+
+static struct c_jit c_jit_main;
+
+static void c_jit_compile(struct c_jit *jit);
+static void c_jit_free(struct c_jit *jit);
+#endif
+
+#if C_INSTANCES
+struct c_instance {
+	union c_insn *code;
+	c_int *data;
+	union c_insn stack[C_STACK_SIZE];
+#if C_JIT
+	struct c_jit jit;
+#endif
+};
+#endif
+
 static void c_init(void)
 {
 	int c;
@@ -359,6 +413,9 @@ static void c_free_fixup(struct c_fixup *list, union c_insn *pc)
 }
 
 void c_cleanup() {
+#if C_JIT
+	c_jit_free(&c_jit_main);
+#endif
 	MEM_FREE(c_code_start);
 	MEM_FREE(c_data_start);
 	c_free_ident(c_funcs, NULL);
@@ -386,6 +443,16 @@ static void (*c_op_push_mem_mem_mem_mem)(void);
 static void (*c_op_assign)(void);
 static void (*c_op_assign_pop)(void);
 
+static void (*c_op_bz_assign)(void);
+static void (*c_op_bz_eq)(void);
+static void (*c_op_bz_ne)(void);
+static void (*c_op_bz_gt)(void);
+static void (*c_op_bz_lt)(void);
+static void (*c_op_bz_ge)(void);
+static void (*c_op_bz_le)(void);
+
+static void (*c_expr_last)(void);
+
 static void (*c_push
 	(void (*last)(void), void (*op)(void), union c_insn *value))(void)
 {
@@ -437,6 +504,65 @@ static void (*c_push
 	return last;
 }
 
+/*
+ * Unary operators applied to a constant are folded into it, which mostly
+ * takes care of negative constants.
+ */
+static void (*c_emit(void (*last)(void), int op))(void)
+{
+	if (c_ops[op].class == C_CLASS_LEFT && !c_ops[op].name[1] &&
+	    (last == c_op_push_imm || last == c_op_push_imm_imm ||
+	    last == c_op_push_mem_imm || last == c_op_push_mem_mem_mem_imm)) {
+		if (c_pass) {
+			c_int *value = &(c_code_ptr - 1)->imm;
+			switch (c_ops[op].name[0]) {
+			case '!':
+				*value = !*value;
+				break;
+			case '~':
+				*value = ~*value;
+				break;
+			case '-':
+				*value = -*value;
+			}
+		}
+		return last;
+	}
+
+	if (c_pass)
+		c_code_ptr->op = c_ops[op].op;
+	c_code_ptr++;
+
+	return c_ops[op].op;
+}
+
+/*
+ * Returns the conditional branch fused with the comparison or assignment that
+ * has just been compiled, or NULL if there's none for it.
+ */
+static void (*c_fuse_bz(void (*last)(void)))(void)
+{
+	static struct {
+		char *name;
+		void (**op)(void);
+	} fused[] = {
+		{"=", &c_op_bz_assign},
+		{"==", &c_op_bz_eq},
+		{"!=", &c_op_bz_ne},
+		{">", &c_op_bz_gt},
+		{"<", &c_op_bz_lt},
+		{">=", &c_op_bz_ge},
+		{"<=", &c_op_bz_le}
+	};
+	int i;
+
+	for (i = 0; i < sizeof(fused) / sizeof(fused[0]); i++)
+	if (last == c_ops[c_find_op(fused[i].name, 1)].op)
+		return *fused[i].op;
+
+	return NULL;
+}
+
 static int c_block(char term, struct c_ident *vars);
 
 static int c_define(char term, struct c_ident **vars, struct c_ident *globals)
@@ -521,10 +647,7 @@ static int c_expr(char term, struct c_ident *vars, char *token, int pop)
 				if (c_ops[stack[sp]].class == C_CLASS_BINARY)
 					balance--;
 
-				last = c_ops[stack[sp]].op;
-				if (c_pass)
-					c_code_ptr->op = last;
-				c_code_ptr++;
+				last = c_emit(last, stack[sp]);
 
 				if (!stack[sp]) break;
 			}
@@ -597,10 +720,7 @@ static int c_expr(char term, struct c_ident *vars, char *token, int pop)
 					if (op2->class == C_CLASS_BINARY)
 						balance--;
 
-					last = op2->op;
-					if (c_pass)
-						c_code_ptr->op = last;
-					c_code_ptr++;
+					last = c_emit(last, stack[sp - 1]);
 
 					sp--;
 				}
@@ -634,6 +754,8 @@ static int c_expr(char term, struct c_ident *vars, char *token, int pop)
 		}
 	}
 
+	c_expr_last = last;
+
 	if (!term && !c_errno) c_errno = C_ERROR_NOTINFUNC;
 	if (*token == term) return -1;
 
@@ -646,6 +768,7 @@ static int c_cond(char term, struct c_ident *vars, char *token)
 	char *pos;
 	union c_insn *start, *outer_loop_start, *fixup;
 	struct c_fixup *outer_loop_break_fixups;
+	void (*fused)(void);
 
 	if (!term) return c_errno = C_ERROR_NOTINFUNC;
 
@@ -664,9 +787,14 @@ static int c_cond(char term, struct c_ident *vars, char *token)
 		return c_errno;
 	}
 
-	if (c_pass)
-		c_code_ptr->op = c_op_bz;
-	c_code_ptr++;
+	if ((fused = c_fuse_bz(c_expr_last))) {
+		if (c_pass)
+			(c_code_ptr - 1)->op = fused;
+	} else {
+		if (c_pass)
+			c_code_ptr->op = c_op_bz;
+		c_code_ptr++;
+	}
 	fixup = c_code_ptr++;
 
 	outer_loop_start = c_loop_start;
@@ -835,12 +963,16 @@ int c_compile(int (*ext_getchar)(void), void (*ext_rewind)(void),
 {
 #if defined(__GNUC__) && !defined(PRINT_INSNS)
 	if (!c_ops_initialized)
-		c_execute_fast(NULL);
+		c_run(NULL, NULL);
 #endif
 
 	c_ext_getchar = ext_getchar;
 	c_ext_rewind = ext_rewind;
+	c_externs = externs;
 
+#if C_JIT
+	c_jit_free(&c_jit_main);
+#endif
 	MEM_FREE(c_code_start);
 	MEM_FREE(c_data_start);
 	c_free_ident(c_funcs, NULL);
@@ -867,6 +999,15 @@ int c_compile(int (*ext_getchar)(void), void (*ext_rewind)(void),
 		memset(c_data_start, 0, (size_t)c_data_ptr);
 	}
 
+#if C_JIT
+	if (!c_errno) {
+		c_jit_main.start = c_code_start;
+		c_jit_main.end = c_code_ptr;
+		c_jit_main.stack = c_stack;
+		c_jit_compile(&c_jit_main);
+	}
+#endif
+
 	return c_errno;
 }
 
@@ -915,17 +1056,34 @@ void c_execute_fast(void *addr)
 
 #else
 
+#if C_JIT
+static void c_jit_run(struct c_jit *jit, union c_insn *pc)
+{
+	((void (*)(unsigned char *))jit->code)
+	    (jit->code + jit->map[pc - jit->start]);
+}
+#endif
+
 void c_execute_fast(void *addr)
 {
-	union c_insn *pc = addr;
+#if C_JIT
+	if (c_jit_main.code) {
+		c_jit_run(&c_jit_main, addr);
+		return;
+	}
+#endif
+
+	c_run(addr, c_stack);
+}
+
 /*
- * We cache the top of stack value in imm.  We initially set sp to &c_stack[2]
- * so that there's room for op_push_* to spill imm to stack even when there
- * wasn't actually a previous top of stack value to cache (since we're at the
- * top level).  It is simpler and quicker to let them do it than to treat this
- * as a special case in the code.
+ * Executes the code at pc using the given stack, or initializes c_ops[] and
+ * the c_op_* pointers if pc is NULL.  Everything else it uses is local, so it
+ * may run in several threads at once as long as the stacks are different.
  */
-	union c_insn *sp = &c_stack[2];
+static void c_run(union c_insn *pc, union c_insn *stack)
+{
+	union c_insn *sp;
 	c_int imm = 0;
 
 /* Must be in the same order as c_ops[] */
@@ -970,9 +1128,9 @@ void c_execute_fast(void *addr)
 	};
 
 #if __GNUC__ >= 3
-	if (__builtin_expect(addr == NULL, 0)) {
+	if (__builtin_expect(pc == NULL, 0)) {
 #else
-	if (!addr) {
+	if (!pc) {
 #endif
 		int op = 0;
 
@@ -997,6 +1155,14 @@ void c_execute_fast(void *addr)
 		c_op_assign = &&op_assign;
 		c_op_assign_pop = &&op_assign_pop;
 
+		c_op_bz_assign = &&op_bz_assign;
+		c_op_bz_eq = &&op_bz_eq;
+		c_op_bz_ne = &&op_bz_ne;
+		c_op_bz_gt = &&op_bz_gt;
+		c_op_bz_lt = &&op_bz_lt;
+		c_op_bz_ge = &&op_bz_ge;
+		c_op_bz_le = &&op_bz_le;
+
 		do {
 			c_ops[op].op = ops[op];
 		} while (c_ops[++op].prec);
@@ -1004,6 +1170,15 @@ void c_execute_fast(void *addr)
 		return;
 	}
 
+/*
+ * We cache the top of stack value in imm.  We initially set sp to &stack[2]
+ * so that there's room for op_push_* to spill imm to stack even when there
+ * wasn't actually a previous top of stack value to cache (since we're at the
+ * top level).  It is simpler and quicker to let them do it than to treat this
+ * as a special case in the code.
+ */
+	sp = &stack[2];
+
 	goto *(pc++)->op;
 
 op_return:
@@ -1024,6 +1199,63 @@ op_ba:
 	pc = pc->pc;
 	goto *(pc++)->op;
 
+op_bz_assign:
+	*(sp - 3)->mem = imm;
+	sp -= 4;
+	if (imm) {
+		pc += 2;
+		goto *(pc - 1)->op;
+	}
+	goto op_ba;
+
+op_bz_eq:
+	sp -= 4;
+	if (sp->imm == imm) {
+		pc += 2;
+		goto *(pc - 1)->op;
+	}
+	goto op_ba;
+
+op_bz_ne:
+	sp -= 4;
+	if (sp->imm != imm) {
+		pc += 2;
+		goto *(pc - 1)->op;
+	}
+	goto op_ba;
+
+op_bz_gt:
+	sp -= 4;
+	if (sp->imm > imm) {
+		pc += 2;
+		goto *(pc - 1)->op;
+	}
+	goto op_ba;
+
+op_bz_lt:
+	sp -= 4;
+	if (sp->imm < imm) {
+		pc += 2;
+		goto *(pc - 1)->op;
+	}
+	goto op_ba;
+
+op_bz_ge:
+	sp -= 4;
+	if (sp->imm >= imm) {
+		pc += 2;
+		goto *(pc - 1)->op;
+	}
+	goto op_ba;
+
+op_bz_le:
+	sp -= 4;
+	if (sp->imm <= imm) {
+		pc += 2;
+		goto *(pc - 1)->op;
+	}
+	goto op_ba;
+
 op_push_imm:
 	(sp - 2)->imm = imm;
 	imm = pc->imm;
@@ -1279,6 +1511,425 @@ op_dec_r:
 
 #endif
 
+#if C_JIT
+
+/*
+ * x86-64 native code generator.  Every instruction is translated to a fixed
+ * sequence of machine code doing exactly what its label in c_run() above
+ * does, with the same register assignment: eax holds the cached top of stack
+ * value and rbx is sp into the code's stack.  The superinstructions
+ * are expanded back into their individual pushes, which is no slower here.
+ * Since there are no calls between the compiled functions, a "return" simply
+ * returns to c_jit_run().  Every instance gets its own translation, since
+ * the addresses of the stack and of the data are embedded in the code.
+ */
+
+#define C_JIT_SP_SUB2			"\x48\x83\xeb\x10"
+#define C_JIT_SP_SUB4			"\x48\x83\xeb\x20"
+#define C_JIT_SP_ADD2			"\x48\x83\xc3\x10"
+#define C_JIT_MEM_LEFT			"\x48\x8b\x53\xe8" /* rdx = (sp - 3)->mem */
+
+#define C_JIT_OP(code) \
+	{code, sizeof(code) - 1}
+
+/* Must be in the same order as c_ops[] */
+static const struct {
+	const char *code;
+	size_t size;
+} c_jit_ops[] = {
+	/* [ */
+	C_JIT_OP(C_JIT_MEM_LEFT "\x48\x63\xc8\x48\x8d\x14\x8a"
+	    "\x48\x89\x53\xe8\x8b\x02" C_JIT_SP_SUB2),
+	/* = */
+	C_JIT_OP(C_JIT_MEM_LEFT "\x89\x02" C_JIT_SP_SUB2),
+	/* += -= *= */
+	C_JIT_OP(C_JIT_MEM_LEFT "\x8b\x0a\x01\xc1\x89\x0a\x89\xc8"
+	    C_JIT_SP_SUB2),
+	C_JIT_OP(C_JIT_MEM_LEFT "\x8b\x0a\x29\xc1\x89\x0a\x89\xc8"
+	    C_JIT_SP_SUB2),
+	C_JIT_OP(C_JIT_MEM_LEFT "\x8b\x0a\x0f\xaf\xc8\x89\x0a\x89\xc8"
+	    C_JIT_SP_SUB2),
+	/* /= %= */
+	C_JIT_OP(C_JIT_MEM_LEFT "\x48\x89\xd6\x89\xc1\x8b\x06\x99\xf7\xf9"
+	    "\x89\x06" C_JIT_SP_SUB2),
+	C_JIT_OP(C_JIT_MEM_LEFT "\x48\x89\xd6\x89\xc1\x8b\x06\x99\xf7\xf9"
+	    "\x89\xd0\x89\x06" C_JIT_SP_SUB2),
+	/* |= ^= &= */
+	C_JIT_OP(C_JIT_MEM_LEFT "\x8b\x0a\x09\xc1\x89\x0a\x89\xc8"
+	    C_JIT_SP_SUB2),
+	C_JIT_OP(C_JIT_MEM_LEFT "\x8b\x0a\x31\xc1\x89\x0a\x89\xc8"
+	    C_JIT_SP_SUB2),
+	C_JIT_OP(C_JIT_MEM_LEFT "\x8b\x0a\x21\xc1\x89\x0a\x89\xc8"
+	    C_JIT_SP_SUB2),
+	/* <<= >>= */
+	C_JIT_OP(C_JIT_MEM_LEFT "\x89\xc1\x8b\x02\xd3\xe0\x89\x02"
+	    C_JIT_SP_SUB2),
+	C_JIT_OP(C_JIT_MEM_LEFT "\x89\xc1\x8b\x02\xd3\xf8\x89\x02"
+	    C_JIT_SP_SUB2),
+	/* || (same as |) */
+	C_JIT_OP("\x0b\x43\xe0" C_JIT_SP_SUB2),
+	/* && */
+	C_JIT_OP("\x83\x7b\xe0\x00\x0f\x95\xc1\x85\xc0\x0f\x95\xc0\x20\xc8"
+	    "\x0f\xb6\xc0" C_JIT_SP_SUB2),
+	/* | ^ & */
+	C_JIT_OP("\x0b\x43\xe0" C_JIT_SP_SUB2),
+	C_JIT_OP("\x33\x43\xe0" C_JIT_SP_SUB2),
+	C_JIT_OP("\x23\x43\xe0" C_JIT_SP_SUB2),
+	/* == */
+	C_JIT_OP("\x39\x43\xe0\x0f\x94\xc0\x0f\xb6\xc0" C_JIT_SP_SUB2),
+	/* != (same as binary -) */
+	C_JIT_OP("\x89\xc1\x8b\x43\xe0\x29\xc8" C_JIT_SP_SUB2),
+	/* > < >= <= */
+	C_JIT_OP("\x39\x43\xe0\x0f\x9f\xc0\x0f\xb6\xc0" C_JIT_SP_SUB2),
+	C_JIT_OP("\x39\x43\xe0\x0f\x9c\xc0\x0f\xb6\xc0" C_JIT_SP_SUB2),
+	C_JIT_OP("\x39\x43\xe0\x0f\x9d\xc0\x0f\xb6\xc0" C_JIT_SP_SUB2),
+	C_JIT_OP("\x39\x43\xe0\x0f\x9e\xc0\x0f\xb6\xc0" C_JIT_SP_SUB2),
+	/* << >> */
+	C_JIT_OP("\x89\xc1\x8b\x43\xe0\xd3\xe0" C_JIT_SP_SUB2),
+	C_JIT_OP("\x89\xc1\x8b\x43\xe0\xd3\xf8" C_JIT_SP_SUB2),
+	/* + - * */
+	C_JIT_OP("\x03\x43\xe0" C_JIT_SP_SUB2),
+	C_JIT_OP("\x89\xc1\x8b\x43\xe0\x29\xc8" C_JIT_SP_SUB2),
+	C_JIT_OP("\x0f\xaf\x43\xe0" C_JIT_SP_SUB2),
+	/* / % */
+	C_JIT_OP("\x89\xc1\x8b\x43\xe0\x99\xf7\xf9" C_JIT_SP_SUB2),
+	C_JIT_OP("\x89\xc1\x8b\x43\xe0\x99\xf7\xf9\x89\xd0" C_JIT_SP_SUB2),
+	/* ! ~ - */
+	C_JIT_OP("\x85\xc0\x0f\x94\xc0\x0f\xb6\xc0"),
+	C_JIT_OP("\xf7\xd0"),
+	C_JIT_OP("\xf7\xd8"),
+	/* ++x --x */
+	C_JIT_OP("\x48\x8b\x53\xf8\xff\xc0\x89\x02"),
+	C_JIT_OP("\x48\x8b\x53\xf8\xff\xc8\x89\x02"),
+	/* x++ x-- */
+	C_JIT_OP("\x48\x8b\x53\xf8\x8d\x48\x01\x89\x0a"),
+	C_JIT_OP("\x48\x8b\x53\xf8\x8d\x48\xff\x89\x0a")
+};
+
+static struct c_jit *c_jit;
+static size_t c_jit_pos;
+
+static void c_jit_emit(const void *code, size_t size)
+{
+	if (c_jit->code)
+		memcpy(c_jit->code + c_jit_pos, code, size);
+	c_jit_pos += size;
+}
+
+#define C_JIT_EMIT(code) \
+	c_jit_emit(code, sizeof(code) - 1)
+
+static void c_jit_push(int mem, union c_insn *value)
+{
+/* (sp - 2)->imm = imm */
+	C_JIT_EMIT("\x89\x43\xf0");
+	if (mem) {
+/* imm = *((sp + 1)->mem = value->mem) */
+		C_JIT_EMIT("\x48\xba");
+		c_jit_emit(&value->mem, 8);
+		C_JIT_EMIT("\x48\x89\x53\x08\x8b\x02");
+	} else {
+/* imm = value->imm */
+		C_JIT_EMIT("\xb8");
+		c_jit_emit(&value->imm, 4);
+	}
+	C_JIT_EMIT(C_JIT_SP_ADD2);
+}
+
+static int c_jit_branch(const char *code, size_t size, union c_insn *target)
+{
+	size_t index = target - c_jit->start;
+	int offset;
+
+	if (index >= (size_t)(c_jit->end - c_jit->start))
+		return -1;
+
+	c_jit_emit(code, size);
+	offset = (int)c_jit->map[index] - (int)(c_jit_pos + 4);
+	c_jit_emit(&offset, 4);
+
+	return 0;
+}
+
+static void c_jit_free(struct c_jit *jit)
+{
+	if (jit->code)
+		munmap(jit->code, jit->size);
+	jit->code = NULL;
+	MEM_FREE(jit->map);
+}
+
+static int c_jit_pass(void)
+{
+	union c_insn *pc = c_jit->start;
+
+	c_jit_pos = 0;
+
+/*
+ * Entry point, called with the address to start at in rdi: save rbx, set sp
+ * to &stack[2] as c_run() does, and jump there.
+ */
+	C_JIT_EMIT("\x53\x48\xbb");
+	{
+		union c_insn *sp = &c_jit->stack[2];
+		c_jit_emit(&sp, 8);
+	}
+	C_JIT_EMIT("\x31\xc0\xff\xe7");
+
+	while (pc < c_jit->end) {
+		void (*op)(void) = (pc++)->op;
+		int i;
+
+		c_jit->map[pc - 1 - c_jit->start] = c_jit_pos;
+
+		if (op == c_op_return) {
+			C_JIT_EMIT("\x5b\xc3");
+		} else if (op == c_op_bz) {
+			C_JIT_EMIT(C_JIT_SP_SUB2 "\x85\xc0");
+			if (c_jit_branch("\x0f\x84", 2, (pc++)->pc))
+				return -1;
+		} else if (op == c_op_bz_assign) {
+			C_JIT_EMIT(C_JIT_MEM_LEFT "\x89\x02" C_JIT_SP_SUB4
+			    "\x85\xc0");
+			if (c_jit_branch("\x0f\x84", 2, (pc++)->pc))
+				return -1;
+		} else if (op == c_op_bz_eq || op == c_op_bz_ne ||
+		    op == c_op_bz_gt || op == c_op_bz_lt ||
+		    op == c_op_bz_ge || op == c_op_bz_le) {
+/* cmp [rbx], eax and a jump on the opposite condition */
+			C_JIT_EMIT(C_JIT_SP_SUB4 "\x39\x03");
+			if (c_jit_branch(
+			    op == c_op_bz_eq ? "\x0f\x85" :
+			    op == c_op_bz_ne ? "\x0f\x84" :
+			    op == c_op_bz_gt ? "\x0f\x8e" :
+			    op == c_op_bz_lt ? "\x0f\x8d" :
+			    op == c_op_bz_ge ? "\x0f\x8c" : "\x0f\x8f",
+			    2, (pc++)->pc))
+				return -1;
+		} else if (op == c_op_ba) {
+			if (c_jit_branch("\xe9", 1, (pc++)->pc))
+				return -1;
+		} else if (op == c_op_push_imm) {
+			c_jit_push(0, pc++);
+		} else if (op == c_op_push_mem) {
+			c_jit_push(1, pc++);
+		} else if (op == c_op_pop) {
+			C_JIT_EMIT(C_JIT_SP_SUB2);
+		} else if (op == c_op_push_imm_imm) {
+			c_jit_push(0, pc++);
+			c_jit_push(0, pc++);
+		} else if (op == c_op_push_imm_mem) {
+			c_jit_push(0, pc++);
+			c_jit_push(1, pc++);
+		} else if (op == c_op_push_mem_imm) {
+			c_jit_push(1, pc++);
+			c_jit_push(0, pc++);
+		} else if (op == c_op_push_mem_mem) {
+			c_jit_push(1, pc++);
+			c_jit_push(1, pc++);
+		} else if (op == c_op_push_mem_mem_mem) {
+			c_jit_push(1, pc++);
+			c_jit_push(1, pc++);
+			c_jit_push(1, pc++);
+		} else if (op == c_op_push_mem_mem_mem_imm ||
+		    op == c_op_push_mem_mem_mem_mem) {
+			c_jit_push(1, pc++);
+			c_jit_push(1, pc++);
+			c_jit_push(1, pc++);
+			c_jit_push(op == c_op_push_mem_mem_mem_mem, pc++);
+		} else if (op == c_op_assign_pop) {
+			C_JIT_EMIT(C_JIT_MEM_LEFT "\x89\x02" C_JIT_SP_SUB4);
+		} else {
+			for (i = 0; c_ops[i].prec; i++)
+			if (c_ops[i].op == op)
+				break;
+			if (!c_ops[i].prec ||
+			    i >= sizeof(c_jit_ops) / sizeof(c_jit_ops[0]))
+				return -1;
+			c_jit_emit(c_jit_ops[i].code, c_jit_ops[i].size);
+		}
+	}
+
+	return pc == c_jit->end ? 0 : -1;
+}
+
+static void c_jit_compile(struct c_jit *jit)
+{
+	void *code;
+
+	c_jit = jit;
+	jit->code = NULL;
+	jit->map = mem_calloc(jit->end - jit->start, sizeof(*jit->map));
+
+/* The first pass only calculates the size and the branch targets */
+	if (c_jit_pass())
+		goto fail;
+
+	jit->size = c_jit_pos;
+	code = mmap(NULL, jit->size, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED)
+		goto fail;
+	jit->code = code;
+
+	if (c_jit_pass() || c_jit_pos != jit->size ||
+	    mprotect(jit->code, jit->size, PROT_READ | PROT_EXEC))
+		goto fail;
+
+	return;
+
+fail:
+	c_jit_free(jit);
+}
+
+#endif
+
+#if C_INSTANCES
+
+/*
+ * Returns the kinds of the operands following op in the code: 'p' for a
+ * branch target, 'i' for an immediate value and 'm' for a variable address.
+ */
+static const char *c_operands(void (*op)(void))
+{
+	if (op == c_op_bz || op == c_op_ba || op == c_op_bz_assign ||
+	    op == c_op_bz_eq || op == c_op_bz_ne || op == c_op_bz_gt ||
+	    op == c_op_bz_lt || op == c_op_bz_ge || op == c_op_bz_le)
+		return "p";
+	if (op == c_op_push_imm)
+		return "i";
+	if (op == c_op_push_mem)
+		return "m";
+	if (op == c_op_push_imm_imm)
+		return "ii";
+	if (op == c_op_push_imm_mem)
+		return "im";
+	if (op == c_op_push_mem_imm)
+		return "mi";
+	if (op == c_op_push_mem_mem)
+		return "mm";
+	if (op == c_op_push_mem_mem_mem)
+		return "mmm";
+	if (op == c_op_push_mem_mem_mem_imm)
+		return "mmmi";
+	if (op == c_op_push_mem_mem_mem_mem)
+		return "mmmm";
+	return "";
+}
+
+/*
+ * Points a copy of the code at the instance's own data, externs and code.
+ */
+static int c_relocate(struct c_instance *instance, struct c_ident *externs)
+{
+	union c_insn *pc = instance->code;
+	union c_insn *end = pc + (c_code_ptr - c_code_start);
+
+	while (pc < end) {
+		const char *kind = c_operands((pc++)->op);
+
+		for (; *kind; kind++, pc++)
+		if (*kind == 'p') {
+			pc->pc = instance->code + (pc->pc - c_code_start);
+		} else if (*kind == 'm') {
+			struct c_ident *orig = c_externs, *copy = externs;
+
+			if (pc->mem >= c_data_start && pc->mem < c_data_ptr) {
+				pc->mem = instance->data +
+				    (pc->mem - c_data_start);
+				continue;
+			}
+
+			while (orig && copy && orig->addr != pc->mem) {
+				orig = orig->next;
+				copy = copy->next;
+			}
+			if (!orig || !copy)
+				return -1;
+			pc->mem = copy->addr;
+		}
+	}
+
+	return pc == end ? 0 : -1;
+}
+
+struct c_instance *c_instance_new(struct c_ident *externs)
+{
+	struct c_instance *instance;
+	size_t code_size = (char *)c_code_ptr - (char *)c_code_start;
+	size_t data_size = (char *)c_data_ptr - (char *)c_data_start;
+
+	if (!c_code_start)
+		return NULL;
+
+	instance = mem_calloc(1, sizeof(*instance));
+	instance->code = mem_alloc(code_size);
+	memcpy(instance->code, c_code_start, code_size);
+	instance->data = mem_alloc(data_size + sizeof(c_int));
+	memcpy(instance->data, c_data_start, data_size);
+
+	if (c_relocate(instance, externs)) {
+		c_instance_free(instance);
+		return NULL;
+	}
+
+#if C_JIT
+	if (c_jit_main.code) {
+		instance->jit.start = instance->code;
+		instance->jit.end = instance->code + (c_code_ptr - c_code_start);
+		instance->jit.stack = instance->stack;
+		c_jit_compile(&instance->jit);
+	}
+#endif
+
+	return instance;
+}
+
+void c_instance_execute(struct c_instance *instance, void *addr)
+{
+	union c_insn *pc =
+	    instance->code + ((union c_insn *)addr - c_code_start);
+
+#if C_JIT
+	if (instance->jit.code) {
+		c_jit_run(&instance->jit, pc);
+		return;
+	}
+#endif
+
+	c_run(pc, instance->stack);
+}
+
+void c_instance_free(struct c_instance *instance)
+{
+	if (!instance)
+		return;
+
+#if C_JIT
+	c_jit_free(&instance->jit);
+#endif
+	MEM_FREE(instance->code);
+	MEM_FREE(instance->data);
+	MEM_FREE(instance);
+}
+
+#else
+
+struct c_instance *c_instance_new(struct c_ident *externs)
+{
+	return NULL;
+}
+
+void c_instance_execute(struct c_instance *instance, void *addr)
+{
+}
+
+void c_instance_free(struct c_instance *instance)
+{
+}
+
+#endif
+
 static void c_f_op_return(void)
 {
 	c_pc = (c_sp -= 2)->pc;
@@ -1297,6 +1948,69 @@ static void c_f_op_ba(void)
 	c_pc = c_pc->pc;
 }
 
+static void c_f_op_bz_assign(void)
+{
+	c_sp -= 4;
+	if ((*(c_sp + 1)->mem = (c_sp + 2)->imm))
+		c_pc++;
+	else
+		c_pc = c_pc->pc;
+}
+
+static void c_f_op_bz_eq(void)
+{
+	c_sp -= 4;
+	if (c_sp->imm == (c_sp + 2)->imm)
+		c_pc++;
+	else
+		c_pc = c_pc->pc;
+}
+
+static void c_f_op_bz_ne(void)
+{
+	c_sp -= 4;
+	if (c_sp->imm != (c_sp + 2)->imm)
+		c_pc++;
+	else
+		c_pc = c_pc->pc;
+}
+
+static void c_f_op_bz_gt(void)
+{
+	c_sp -= 4;
+	if (c_sp->imm > (c_sp + 2)->imm)
+		c_pc++;
+	else
+		c_pc = c_pc->pc;
+}
+
+static void c_f_op_bz_lt(void)
+{
+	c_sp -= 4;
+	if (c_sp->imm < (c_sp + 2)->imm)
+		c_pc++;
+	else
+		c_pc = c_pc->pc;
+}
+
+static void c_f_op_bz_ge(void)
+{
+	c_sp -= 4;
+	if (c_sp->imm >= (c_sp + 2)->imm)
+		c_pc++;
+	else
+		c_pc = c_pc->pc;
+}
+
+static void c_f_op_bz_le(void)
+{
+	c_sp -= 4;
+	if (c_sp->imm <= (c_sp + 2)->imm)
+		c_pc++;
+	else
+		c_pc = c_pc->pc;
+}
+
 static void c_f_op_push_imm(void)
 {
 	c_sp->imm = (c_pc++)->imm;
@@ -1609,6 +2323,14 @@ static void (*c_op_push_mem_mem_mem_mem)(void) = c_f_op_push_mem_mem_mem_mem;
 static void (*c_op_assign)(void) = c_f_op_assign;
 static void (*c_op_assign_pop)(void) = c_f_op_assign_pop;
 
+static void (*c_op_bz_assign)(void) = c_f_op_bz_assign;
+static void (*c_op_bz_eq)(void) = c_f_op_bz_eq;
+static void (*c_op_bz_ne)(void) = c_f_op_bz_ne;
+static void (*c_op_bz_gt)(void) = c_f_op_bz_gt;
+static void (*c_op_bz_lt)(void) = c_f_op_bz_lt;
+static void (*c_op_bz_ge)(void) = c_f_op_bz_ge;
+static void (*c_op_bz_le)(void) = c_f_op_bz_le;
+
 /* Must be in the same order as ops[] in c_execute_fast() */
 static struct c_op c_ops[] = {
 	{1, C_LEFT_TO_RIGHT, C_CLASS_BINARY, "[", c_op_index},
@@ -1663,6 +2385,13 @@ static struct c_op c_ops[] = {
 	{0, 0, 0, "push_mem_mem_mem_imm", c_f_op_push_mem_mem_mem_imm},
 	{0, 0, 0, "push_mem_mem_mem_mem", c_f_op_push_mem_mem_mem_mem},
 	{0, 0, 0, "assign_pop", c_f_op_assign_pop},
+	{0, 0, 0, "bz_assign", c_f_op_bz_assign},
+	{0, 0, 0, "bz_eq", c_f_op_bz_eq},
+	{0, 0, 0, "bz_ne", c_f_op_bz_ne},
+	{0, 0, 0, "bz_gt", c_f_op_bz_gt},
+	{0, 0, 0, "bz_lt", c_f_op_bz_lt},
+	{0, 0, 0, "bz_ge", c_f_op_bz_ge},
+	{0, 0, 0, "bz_le", c_f_op_bz_le},
 	{-1}
 #else
 	{0}
@@ -85,6 +85,29 @@ extern void *c_lookup(const char *name);
 		c_execute_fast(addr)
 extern void c_execute_fast(void *addr);
 
+/*
+ * A separate copy of the program compiled last, with its own data, stack and
+ * externs.  Different instances may be executed by different threads at once.
+ */
+struct c_instance;
+
+/*
+ * Creates an instance starting out with a copy of the program's current data.
+ * The externs must be the same identifiers, in the same order, as were passed
+ * to c_compile(), but with the addresses of this instance's copies of them.
+ * Returns NULL if instances aren't supported in this build.  This and
+ * c_instance_free() are not thread-safe, and instances must be freed before
+ * the next c_compile().
+ */
+extern struct c_instance *c_instance_new(struct c_ident *externs);
+
+/*
+ * Executes a function, as returned by c_lookup(), in an instance.
+ */
+extern void c_instance_execute(struct c_instance *instance, void *addr);
+
+extern void c_instance_free(struct c_instance *instance);
+
 extern void c_cleanup();
 
 #endif
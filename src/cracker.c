@@ -66,6 +66,7 @@
 #include "gpu_common.h"
 #endif
 #include "rules.h"
+#include "suppressor.h"
 #include "tty.h"
 
 #ifdef index
@@ -1229,6 +1230,22 @@ int crk_direct_process_key(char *key)
 	return ext_abort;
 }
 
+int crk_process_key_delta(char *key, int pos)
+{
+	if (crk_key_index && crk_key_index < crk_process_key_max_keys &&
+	    crk_methods.set_key_delta &&
+	    crk_process_key == crk_direct_process_key) {
+		crk_methods.set_key_delta(key, pos, crk_key_index++);
+
+		if (crk_key_index >= crk_process_key_max_keys)
+			return crk_salt_loop();
+
+		return 0;
+	}
+
+	return crk_process_key(key);
+}
+
 static int process_key_stack_rules(char *key)
 {
 	int ret = 0;
@@ -1334,6 +1351,9 @@ char *crk_get_key2(void)
 
 void crk_done(void)
 {
+	if (!event_abort)
+		suppressor_flush();
+
 	if (crk_db->loaded) {
 		if (crk_key_index && crk_db->salts && !event_abort)
 			crk_salt_loop();
@@ -48,6 +48,13 @@ extern int crk_direct_process_key(char *key);
  */
 extern int (*crk_process_key)(char *key);
 
+/*
+ * Same as crk_process_key(), for a pure 7-bit key of the same length as the
+ * previous one passed to us, and that only differs from it by the character
+ * at position pos.  Uses the format's set_key_delta() when possible.
+ */
+extern int crk_process_key_delta(char *key, int pos);
+
 /*
  * Process all/any keys already loaded with crk_process_key, regardless of
  * max_keys_per_crypt.  After this, it's safe to call reset() mid-run.
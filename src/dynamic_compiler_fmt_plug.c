@@ -31,6 +31,10 @@
 	#define BITS ARCH_BITS_STR
 #endif
 
+#if !FAST_FORMATS_OMP
+#undef _OPENMP
+#endif
+
 #ifndef DYNAMIC_DISABLED
 
 #if FMT_EXTERNS_H
@@ -174,7 +178,13 @@ struct fmt_main fmt_CompiledDynamic =
 		// here, but will be reset within our init() function.
 		FORMAT_LABEL, FORMAT_NAME, ALGORITHM_NAME, BENCHMARK_COMMENT, BENCHMARK_LENGTH,
 			/* for now, turn off FMT_SPLIT_UNIFIES_CASE until we get the code right */
-		0, 0, 16, BINARY_ALIGN, DYNA_SALT_SIZE, SALT_ALIGN, 1, 1, FMT_CASE | FMT_8_BIT | FMT_DYNAMIC /*| FMT_SPLIT_UNIFIES_CASE */ ,
+		0, 0, 16, BINARY_ALIGN, DYNA_SALT_SIZE, SALT_ALIGN, 1, 1,
+#ifdef _OPENMP
+		/* so that --test and --list see it before init(); the linked
+		 * format's own flags (with bad-OMP scripts masked) replace these */
+		FMT_OMP | FMT_OMP_BAD |
+#endif
+		FMT_CASE | FMT_8_BIT | FMT_DYNAMIC /*| FMT_SPLIT_UNIFIES_CASE */ ,
 		{ NULL },
 		{ NULL },
 		tests
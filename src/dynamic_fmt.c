@@ -8479,6 +8479,8 @@ void dynamic_switch_compiled_format_to_RDP(struct fmt_main *pFmt)
 		dynamic_use_sse = 0;
 		curdat.dynamic_use_sse = 0;
 		pFmt->params.algorithm_name = "Dynamic RDP";
+		// run_one_RDP_test() works on the parser's static buffers
+		pFmt->params.flags &= ~(FMT_OMP | FMT_OMP_BAD);
 	}
 }
 #else
@@ -12,9 +12,13 @@
 
 #include <stdio.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "misc.h"
 #include "params.h"
+#include "memory.h"
 #include "os.h" /* Needed for signals.h */
 #include "signals.h"
 #include "compiler.h"
@@ -294,7 +298,13 @@ void ext_init(char *mode, struct db_main *db)
 	ext_mode = mode;
 }
 
-int ext_filter_body(char *in, char *out)
+/*
+ * Non-zero when ext_word[] holds the last word passed to the filter, because
+ * the filter left it unchanged.
+ */
+static int ext_word_is_input;
+
+static int ext_filter_word(char *in, char *out, int pos, int copy)
 {
 	unsigned char *internal;
 	c_int *external;
@@ -302,6 +312,11 @@ int ext_filter_body(char *in, char *out)
 	if (ext_utf32) {
 		enc_to_utf32((UTF32*)ext_word, PLAINTEXT_BUFFER_SIZE,
 		             (UTF8*)in, strlen(in));
+	} else if (pos) {
+		internal = (unsigned char *)in + pos;
+		external = ext_word + pos;
+		while ((*external++ = *internal++))
+			;
 	} else {
 		internal = (unsigned char *)in;
 		external = ext_word;
@@ -326,36 +341,64 @@ int ext_filter_body(char *in, char *out)
 
 	c_execute_fast(f_filter);
 
+	ext_word_is_input = 0;
+
 	if (!ext_word[0] && in[0]) return 0;
 
 	if (ext_utf32) {
 		utf32_to_enc((UTF8*)int_word, maxlen, (UTF32*)ext_word);
-	} else {
-		internal = (unsigned char *)out;
-		external = ext_word;
-		internal[0] = external[0];
-		internal[1] = external[1];
-		internal[2] = external[2];
-		internal[3] = external[3];
-		if (external[0] && external[1] && external[2] && external[3])
-		do {
-			if (!(internal[4] = external[4]))
-				break;
-			if (!(internal[5] = external[5]))
-				break;
-			if (!(internal[6] = external[6]))
-				break;
-			if (!(internal[7] = external[7]))
-				break;
-			internal += 4;
-			external += 4;
-		} while (1);
+		return 1;
+	}
 
-		out[maxlen] = 0;
+	internal = (unsigned char *)in;
+	external = ext_word;
+	while (*external == *internal && *internal) {
+		internal++;
+		external++;
+	}
+	if (*external == *internal &&
+	    internal - (unsigned char *)in <= maxlen) {
+		ext_word_is_input = 1;
+		if (copy && out != in)
+			strcpy(out, in);
+		return 2;
 	}
+
+	internal = (unsigned char *)out;
+	external = ext_word;
+	internal[0] = external[0];
+	internal[1] = external[1];
+	internal[2] = external[2];
+	internal[3] = external[3];
+	if (external[0] && external[1] && external[2] && external[3])
+	do {
+		if (!(internal[4] = external[4]))
+			break;
+		if (!(internal[5] = external[5]))
+			break;
+		if (!(internal[6] = external[6]))
+			break;
+		if (!(internal[7] = external[7]))
+			break;
+		internal += 4;
+		external += 4;
+	} while (1);
+
+	out[maxlen] = 0;
+
 	return 1;
 }
 
+int ext_filter_body(char *in, char *out)
+{
+	return ext_filter_word(in, out, 0, 1);
+}
+
+int ext_filter_delta(char *in, char *out, int pos)
+{
+	return ext_filter_word(in, out, ext_word_is_input ? pos : 0, 0);
+}
+
 static void save_state(FILE *file)
 {
 	unsigned char *ptr;
@@ -464,6 +507,289 @@ void ext_hybrid_fix_state(void)
 	strcpy(hybrid_actual_completed_base_word, int_hybrid_base_word);
 }
 
+/*
+ * Converts a word generated by the external mode to the candidate password.
+ */
+static void ext_convert(c_int *external, char *out)
+{
+	unsigned char *internal;
+
+	if (ext_utf32) {
+		utf32_to_enc((UTF8*)out, maxlen, (UTF32*)external);
+		return;
+	}
+
+	out[0] = external[0];
+	if ((out[1] = external[1])) {
+		internal = (unsigned char *)&out[2];
+		external += 2;
+		do {
+			if (!(internal[0] = external[0]))
+				break;
+			if (!(internal[1] = external[1]))
+				break;
+			if (!(internal[2] = external[2]))
+				break;
+			if (!(internal[3] = external[3]))
+				break;
+			internal += 4;
+			external += 4;
+		} while (1);
+	}
+
+	out[maxlen] = 0;
+}
+
+/*
+ * Tries int_word.  Returns non-zero when it's time to stop.
+ */
+static int ext_process_key(struct db_main *db)
+{
+#if HAVE_REXGEN
+	if (regex) {
+		if (do_regex_hybrid_crack(db, regex, int_word,
+		                          regex_case, regex_alpha))
+			return 1;
+		ext_hybrid_fix_state();
+		return 0;
+	}
+#endif
+	if (options.flags & FLG_MASK_STACKED)
+		return do_mask_crack(int_word);
+
+	return crk_process_key(int_word);
+}
+
+#ifdef _OPENMP
+/*
+ * With a filter() to run or UTF-32 words to convert, the words generated are
+ * dealt out to one instance of the external mode per thread.  Every instance
+ * runs generate() for all of them, but filters and converts only its own,
+ * every ext_threads'th word.  filter() works on a copy of the word, so that
+ * all instances' generate() keep seeing the same state.  The cracker itself
+ * isn't thread-safe, so the resulting keys are then tried in order by the
+ * main thread.
+ */
+#define EXT_BATCH			0x100
+
+struct ext_thread {
+	struct c_instance *instance;
+	struct c_ident *idents;
+	c_int *vars, *word;
+	c_int *abort, *status;
+	unsigned int seq;
+	int my_words, their_words;
+};
+
+/*
+ * Where a word landed.  abort and status are as left by filter() for this
+ * word, gen_abort and gen_status as left by generate() up to it, as seen by
+ * the first instance.
+ */
+struct ext_key {
+	unsigned int seq;
+	c_int abort, status;
+	c_int gen_abort, gen_status;
+};
+
+static int ext_threads;
+static struct ext_thread *ext_thread;
+static struct ext_key *ext_key;
+static char *ext_keys;
+
+static void ext_threads_done(void)
+{
+	int t;
+
+	for (t = 0; t < ext_threads; t++) {
+		c_instance_free(ext_thread[t].instance);
+		MEM_FREE(ext_thread[t].idents);
+		MEM_FREE(ext_thread[t].vars);
+		MEM_FREE(ext_thread[t].word);
+	}
+	MEM_FREE(ext_thread);
+	MEM_FREE(ext_key);
+	MEM_FREE(ext_keys);
+	ext_threads = 0;
+}
+
+static int ext_threads_init(int my_words, int their_words)
+{
+	struct c_ident *ident;
+	int count, t, i;
+
+	if ((!f_filter && !ext_utf32) || omp_get_max_threads() < 2)
+		return 0;
+
+	for (ident = &ext_globals, count = 0; ident; ident = ident->next)
+		count++;
+
+	ext_threads = omp_get_max_threads();
+	ext_thread = mem_calloc(ext_threads, sizeof(*ext_thread));
+
+	for (t = 0; t < ext_threads; t++) {
+		struct ext_thread *thread = &ext_thread[t];
+
+		thread->idents = mem_alloc(count * sizeof(*thread->idents));
+		thread->vars = mem_alloc(count * sizeof(*thread->vars));
+		thread->word = mem_alloc(sizeof(ext_word));
+		memcpy(thread->word, ext_word, sizeof(ext_word));
+
+		for (ident = &ext_globals, i = 0; ident;
+		    ident = ident->next, i++) {
+			struct c_ident *copy = &thread->idents[i];
+
+			copy->next = ident->next ? copy + 1 : NULL;
+			copy->name = ident->name;
+			if (ident->addr == ext_word) {
+				copy->addr = thread->word;
+				continue;
+			}
+			thread->vars[i] = *(c_int *)ident->addr;
+			copy->addr = &thread->vars[i];
+			if (ident->addr == &ext_abort)
+				thread->abort = &thread->vars[i];
+			else if (ident->addr == &ext_status)
+				thread->status = &thread->vars[i];
+		}
+
+		thread->seq = seq;
+		thread->my_words = my_words;
+		thread->their_words = their_words;
+
+		if (!(thread->instance = c_instance_new(thread->idents))) {
+			ext_threads_done();
+			return 0;
+		}
+	}
+
+	ext_key = mem_alloc(EXT_BATCH * ext_threads * sizeof(*ext_key));
+	ext_keys = mem_alloc(EXT_BATCH * ext_threads * PLAINTEXT_BUFFER_SIZE);
+
+	log_event("- Running %d instances of the external mode", ext_threads);
+
+	return 1;
+}
+
+/*
+ * Generates this node's next count words in thread t's instance, filtering
+ * and converting the thread's own ones.  Returns the number generated, which
+ * is less than count only at the end of the external mode's output.
+ */
+static int ext_thread_batch(int t, int count)
+{
+	struct ext_thread *thread = &ext_thread[t];
+	c_int *word = thread->word;
+	c_int saved[PLAINTEXT_BUFFER_SIZE];
+	c_int gen_status = 0;
+	int n = 0;
+
+	while (n < count) {
+		struct ext_key *key;
+		char *out;
+		int i;
+
+		c_instance_execute(thread->instance, f_generate);
+		if (!word[0])
+			break;
+
+		if (*thread->status) {
+			gen_status = *thread->status;
+			*thread->status = 0;
+		}
+
+		if (options.node_count) {
+			thread->seq++;
+			if (thread->their_words) {
+				thread->their_words--;
+				continue;
+			}
+			if (--thread->my_words == 0) {
+				thread->my_words =
+					options.node_max - options.node_min + 1;
+				thread->their_words =
+					options.node_count - thread->my_words;
+			}
+		}
+
+		key = &ext_key[n];
+		if (!t) {
+			key->gen_abort = *thread->abort;
+			key->gen_status = gen_status;
+		}
+		gen_status = 0;
+
+		if (n++ % ext_threads != t)
+			continue;
+
+		key->seq = thread->seq;
+		key->abort = key->status = 0;
+		out = &ext_keys[(n - 1) * PLAINTEXT_BUFFER_SIZE];
+
+		if (!f_filter) {
+			ext_convert(word, out);
+			continue;
+		}
+
+		i = 0;
+		while ((saved[i] = word[i]))
+			i++;
+
+		c_instance_execute(thread->instance, f_filter);
+
+		key->abort = *thread->abort;
+		key->status = *thread->status;
+		*thread->status = 0;
+
+		if (word[0])
+			ext_convert(word, out);
+		else
+			out[0] = 0;
+
+		memcpy(word, saved, (i + 1) * sizeof(*word));
+	}
+
+	return n;
+}
+
+static void ext_threads_crack(struct db_main *db)
+{
+	int count = EXT_BATCH * ext_threads;
+	int end = 0;
+
+	do {
+		int t, n;
+
+#pragma omp parallel for
+		for (t = 0; t < ext_threads; t++) {
+			int done = ext_thread_batch(t, count);
+			if (!t)
+				end = done;
+		}
+
+		for (n = 0; n < end; n++) {
+			struct ext_key *key = &ext_key[n];
+			char *out = &ext_keys[n * PLAINTEXT_BUFFER_SIZE];
+
+			if (key->gen_status || key->status)
+				ext_status = key->gen_status ?
+					key->gen_status : key->status;
+			if (key->gen_abort || key->abort)
+				ext_abort = key->gen_abort ?
+					key->gen_abort : key->abort;
+
+			seq = key->seq;
+			if (!out[0])
+				continue;
+
+			strcpy(int_word, out);
+			if (ext_process_key(db))
+				return;
+		}
+	} while (end == count);
+}
+#endif
+
 void do_external_crack(struct db_main *db)
 {
 	unsigned char *internal;
@@ -517,6 +843,12 @@ void do_external_crack(struct db_main *db)
 		}
 	}
 
+#ifdef _OPENMP
+	if (ext_threads_init(my_words, their_words)) {
+		ext_threads_crack(db);
+		ext_threads_done();
+	} else
+#endif
 	do {
 		c_execute_fast(f_generate);
 		if (!ext_word[0])
@@ -541,42 +873,10 @@ void do_external_crack(struct db_main *db)
 				continue;
 		}
 
-		if (ext_utf32) {
-			utf32_to_enc((UTF8*)int_word, maxlen, (UTF32*)ext_word);
-		} else {
-			int_word[0] = ext_word[0];
-			if ((int_word[1] = ext_word[1])) {
-				internal = (unsigned char *)&int_word[2];
-				external = &ext_word[2];
-				do {
-					if (!(internal[0] = external[0]))
-						break;
-					if (!(internal[1] = external[1]))
-						break;
-					if (!(internal[2] = external[2]))
-						break;
-					if (!(internal[3] = external[3]))
-						break;
-					internal += 4;
-					external += 4;
-				} while (1);
-			}
+		ext_convert(ext_word, int_word);
 
-			int_word[maxlen] = 0;
-		}
-#if HAVE_REXGEN
-		if (regex) {
-			if (do_regex_hybrid_crack(db, regex, int_word,
-			                          regex_case, regex_alpha))
-				break;
-			ext_hybrid_fix_state();
-		} else
-#endif
-		if (options.flags & FLG_MASK_STACKED) {
-			if (do_mask_crack(int_word))
-				break;
-		} else
-		if (crk_process_key(int_word)) break;
+		if (ext_process_key(db))
+			break;
 	} while (1);
 
 	if (!event_abort)
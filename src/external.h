@@ -60,10 +60,19 @@ extern void ext_init(char *mode, struct db_main *db);
 	(!f_filter || ext_filter_body(word, word))
 
 /*
- * The actual implementation of ext_filter(); use the macro instead.
+ * The actual implementation of ext_filter(); use the macro instead.  Returns
+ * 2 rather than 1 if the filter accepted the word without changing it.
  */
 extern int ext_filter_body(char *in, char *out);
 
+/*
+ * Same as ext_filter_body() for a word that differs from the one passed to the
+ * filter in the previous call only from position pos on.  Only that portion
+ * of the word is passed to the filter anew if the previous word was accepted
+ * unchanged.  When returning 2, this does not write to out.
+ */
+extern int ext_filter_delta(char *in, char *out, int pos);
+
 /*
  * Runs the external mode cracker.
  */
@@ -551,6 +551,32 @@ static int is_aligned(void *p, size_t align)
 		format->methods.set_key(buf_key, index); \
 	}
 
+/*
+ * Test set_key_delta(), if present, by setting the key at index - 1 to the
+ * plaintext with its last character changed.  Returns zero if not applicable.
+ */
+static int fmt_set_key_delta(struct fmt_main *format, char *key, int index)
+{
+	char *s;
+	int pos;
+
+	if (!format->methods.set_key_delta || index < 1 || !*key)
+		return 0;
+
+	for (s = key; *s; s++)
+		if (*s & 0x80)
+			return 0;
+
+	pos = s - key - 1;
+	fmt_set_key(key, index - 1);
+	buf_key[pos] = (buf_key[pos] == 'x') ? 'y' : 'x';
+	format->methods.set_key(buf_key, index - 1);
+	buf_key[pos] = key[pos];
+	format->methods.set_key_delta(buf_key, pos, index);
+
+	return 1;
+}
+
 #define MAXLABEL        "3133731337" /* must be non-letter ASCII chars only */
 #define MAXLABEL_SIMD   "80808080\x80" /* Catch a common bug */
 static char *longcand(struct fmt_main *format, int index, int ml)
@@ -1263,7 +1289,8 @@ static char *fmt_self_test_body(struct fmt_main *format,
 				char *pCand = longcand(format, i, ml);
 				fmt_set_key(pCand, i);
 			}
-			fmt_set_key(current->plaintext, max - 1);
+			if (!fmt_set_key_delta(format, current->plaintext, max - 1))
+				fmt_set_key(current->plaintext, max - 1);
 		} else {
 			if (index == 0)
 				format->methods.clear_keys();
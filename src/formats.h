@@ -401,6 +401,13 @@ struct fmt_methods {
 
 /* Compares an ASCII ciphertext against a particular crypt_all() output */
 	int (*cmp_exact)(char *source, int index);
+
+/* Optional, may be left out (NULL).  Sets a plaintext at index (which is
+ * never 0) that only differs from the one just set at index - 1 by the
+ * character at position pos, and is of the same length.  Both plaintexts are
+ * pure 7-bit ASCII.  The full plaintext is passed, as for set_key(), but the
+ * format may instead copy its previous key and patch the one character. */
+	void (*set_key_delta)(char *key, int pos, int index);
 };
 
 /*
@@ -60,6 +60,8 @@ typedef char (*chars_table)
 
 static unsigned int rec_entry, rec_length;
 static unsigned char rec_numbers[CHARSET_LENGTH];
+/* 2 is for sessions where nodes got whole entries, see inc_node_share() */
+static unsigned int rec_compat;
 
 static unsigned int hybrid_rec_entry, hybrid_rec_length;
 static unsigned char hybrid_rec_numbers[CHARSET_LENGTH];
@@ -71,6 +73,12 @@ static int counts[CHARSET_LENGTH][CHARSET_LENGTH];
 static unsigned int real_count, real_minc, real_min, real_max, real_size;
 static unsigned char real_chars[CHARSET_SIZE];
 
+/*
+ * Whether candidates that only differ from the previous one in the last
+ * character may be passed to the format as such.
+ */
+static int inc_delta;
+
 #if HAVE_REXGEN
 static char *regex_alpha;
 static int regex_case;
@@ -81,7 +89,7 @@ static void save_state(FILE *file)
 {
 	unsigned int pos;
 
-	fprintf(file, "%u\n2\n%u\n", rec_entry, rec_length + 1);
+	fprintf(file, "%u\n%u\n%u\n", rec_entry, rec_compat, rec_length + 1);
 	for (pos = 0; pos <= rec_length; pos++)
 		fprintf(file, "%u\n", (unsigned int)rec_numbers[pos]);
 }
@@ -96,8 +104,9 @@ static int restore_state(FILE *file)
 	if (fscanf(file, "%u\n%u\n%u\n", &rec_entry, &compat, &rec_length) != 3)
 		return 1;
 	rec_length--; /* zero-based */
-	if (compat != 2 || rec_length >= CHARSET_LENGTH)
+	if (compat < 2 || compat > 3 || rec_length >= CHARSET_LENGTH)
 		return 1;
+	rec_compat = compat;
 	for (pos = 0; pos <= rec_length; pos++) {
 		unsigned int number;
 		if (fscanf(file, "%u\n", &number) != 1)
@@ -360,8 +369,90 @@ static void inc_new_count(unsigned int length, int count, const char *charset,
 		inc_format_error(charset);
 }
 
+/*
+ * The candidates of one entry are numbered in the order inc_key_loop() tries
+ * them, with numbers[] (except for the fixed position) as the digits of a
+ * mixed-radix number.  Returns the entry's size, or 0 if that doesn't fit.
+ */
+static uint64_t inc_entry_size(int length, int fixed)
+{
+	uint64_t size = 1;
+	int pos;
+
+	for (pos = 0; pos <= length; pos++) {
+		uint64_t radix = counts[length][pos] + 1;
+
+		if (pos == fixed)
+			continue;
+		if (size > ~(uint64_t)0 / radix)
+			return 0;
+		size *= radix;
+	}
+
+	return size;
+}
+
+static uint64_t inc_get_index(int length, int fixed)
+{
+	uint64_t index = 0;
+	int pos;
+
+	for (pos = 0; pos <= length; pos++)
+	if (pos != fixed)
+		index = index * (counts[length][pos] + 1) + numbers[pos];
+
+	return index;
+}
+
+static void inc_set_index(int length, int fixed, uint64_t index)
+{
+	int pos;
+
+	for (pos = length; pos >= 0; pos--)
+	if (pos != fixed) {
+		uint64_t radix = counts[length][pos] + 1;
+
+		numbers[pos] = index % radix;
+		index /= radix;
+	}
+}
+
+/*
+ * Split every entry between nodes, rather than assigning whole entries to
+ * nodes as we used to, because those are of wildly different sizes.  Sets up
+ * numbers[] for our share of the current entry (or what's left of it after a
+ * restore) and returns its size, or 0 if we have none.
+ */
+static uint64_t inc_node_share(int length, int fixed, int restored)
+{
+	uint64_t size, start, end, index;
+	unsigned int nodes = options.node_count;
+
+	if (!nodes)
+		return ~(uint64_t)0;
+
+	if (rec_compat < 3 || !(size = inc_entry_size(length, fixed))) {
+		unsigned int for_node = (entry - 1) % nodes + 1;
+
+		if (for_node < options.node_min || for_node > options.node_max)
+			return 0;
+		return ~(uint64_t)0;
+	}
+
+	start = size / nodes * (options.node_min - 1) +
+		size % nodes * (options.node_min - 1) / nodes;
+	end = size / nodes * options.node_max +
+		size % nodes * options.node_max / nodes;
+
+	index = restored ? inc_get_index(length, fixed) : 0;
+	if (index < start)
+		inc_set_index(length, fixed, index = start);
+
+	return (index < end) ? end - index : 0;
+}
+
 static int inc_key_loop(struct db_main *db, int length, int fixed, int count,
-	char *char1, char2_table char2, chars_table *chars)
+	char *char1, char2_table char2, chars_table *chars, uint64_t todo)
 {
 	char key_i[PLAINTEXT_BUFFER_SIZE];
 	char key_e[PLAINTEXT_BUFFER_SIZE];
@@ -407,6 +498,18 @@ update_last:
 	}
 
 	key = key_i;
+	if (inc_delta) {
+		if (crk_process_key(key))
+			return 1;
+		/* Rest of the last position's sweep, as a run of deltas */
+		if (fixed < length && length >= 2)
+		while (numbers_cache < counts_cache && todo > 1) {
+			todo--;
+			key_i[length] = chars_cache[++numbers_cache];
+			if (crk_process_key_delta(key_i, length))
+				return 1;
+		}
+	} else
 #if HAVE_REXGEN
 	if (regex) {
 		if (do_regex_hybrid_crack(db, regex, key,
@@ -428,6 +531,9 @@ update_last:
 		if (crk_process_key(key))
 			return 1;
 
+	if (!--todo)
+		return 0;
+
 	pos = length;
 	if (fixed < length) {
 		if (++numbers_cache <= counts_cache) {
@@ -742,6 +848,13 @@ void do_incremental_crack(struct db_main *db, const char *mode)
 			    "some candidate passwords may be redundant.\n");
 	}
 
+	inc_delta = !f_filter && !f_new && !(options.flags & FLG_MASK_CHK) &&
+		!has_8bit(allchars);
+#if HAVE_REXGEN
+	if (regex)
+		inc_delta = 0;
+#endif
+
 	char2 = NULL;
 	for (pos = 0; pos < CHARSET_LENGTH - 2; pos++)
 		chars[pos] = NULL;
@@ -753,6 +866,7 @@ void do_incremental_crack(struct db_main *db, const char *mode)
 
 	rec_entry = 0;
 	memset(rec_numbers, 0, sizeof(rec_numbers));
+	rec_compat = options.node_count ? 3 : 2;
 
 	status_init(get_progress, 0);
 
@@ -801,12 +915,8 @@ void do_incremental_crack(struct db_main *db, const char *mode)
 
 	entry--;
 	while (ptr < &header->order[sizeof(header->order) - 1]) {
-		int skip = 0;
-		if (options.node_count) {
-			int for_node = entry % options.node_count + 1;
-			skip = for_node < options.node_min ||
-			    for_node > options.node_max;
-		}
+		uint64_t todo;
+		int skip;
 
 		entry++;
 		length = *ptr++; fixed = *ptr++; count = *ptr++;
@@ -829,6 +939,9 @@ void do_incremental_crack(struct db_main *db, const char *mode)
 		    (int)count >= max_count)
 			continue;
 
+		todo = inc_node_share(length, fixed, entry == rec_entry);
+		skip = !todo;
+
 		if (!skip) {
 			int i, max_count = 0;
 			if ((int)length != last_length) {
@@ -891,7 +1004,8 @@ void do_incremental_crack(struct db_main *db, const char *mode)
 		log_event("- Trying length %d, fixed @%d, character count %d",
 		    length + 1, fixed + 1, counts[length][fixed] + 1);
 
-		if (inc_key_loop(db, length, fixed, count, char1, char2, chars))
+		if (inc_key_loop(db, length, fixed, count, char1, char2, chars,
+		    todo))
 			break;
 	}
 
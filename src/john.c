@@ -539,6 +539,8 @@ static void john_fork(void)
 	unsigned int range = options.node_max - options.node_min + 1;
 	unsigned int npf = range / options.fork;
 
+	mask_fork_init();
+
 	for (i = 1; i < options.fork; i++) {
 		switch ((pid = fork())) {
 		case -1:
@@ -43,79 +43,181 @@ john_register_one(&fmt_KeePass);
 #include "twofish.h"
 #include "chacha.h"
 
+#if __AES__
+#include <wmmintrin.h>
+
+/*
+ * Number of candidates whose key transforms are interleaved.  Each one has
+ * two independent blocks, so this many times two AESENC are in flight.
+ */
+#define AES_PARA                4
+#else
+#define AES_PARA                1
+#endif
+
 #ifndef OMP_SCALE
 #define OMP_SCALE               4 // This and MKPC tuned for core i7
 #endif
 
 #define FORMAT_LABEL            "KeePass"
 #define FORMAT_NAME             ""
+#if __AES__
+#define ALGORITHM_NAME          "SHA256 AES 128/128 AES-NI " STRINGIZE(AES_PARA) "x"
+#else
 #define ALGORITHM_NAME          "SHA256 AES 32/" ARCH_BITS_STR
+#endif
+
+#undef MIN_KEYS_PER_CRYPT
+#define MIN_KEYS_PER_CRYPT      AES_PARA
+#undef MAX_KEYS_PER_CRYPT
+#define MAX_KEYS_PER_CRYPT      AES_PARA
 
 static keepass_salt_t *cur_salt;
 static int any_cracked, *cracked;
 static size_t cracked_size;
+#if __AES__
+static __m128i transf_key[15];
+#else
+static AES_KEY transf_key;
+#endif
 
-// GenerateKey32 from CompositeKey.cs
-static void transform_key(char *masterkey, keepass_salt_t *csp,
-                          unsigned char *final_key)
+#if __AES__
+/* One step of the AES-256 key schedule, see Intel's AES-NI white paper */
+#define KEY_EXP_256(n, rcon) do {	  \
+		t = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k1, rcon), 0xff); \
+		k0 = _mm_xor_si128(k0, _mm_slli_si128(k0, 4)); \
+		k0 = _mm_xor_si128(k0, _mm_slli_si128(k0, 4)); \
+		k0 = _mm_xor_si128(k0, _mm_slli_si128(k0, 4)); \
+		transf_key[n] = k0 = _mm_xor_si128(k0, t); \
+		if (n == 14) \
+			break; \
+		t = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k0, 0), 0xaa); \
+		k1 = _mm_xor_si128(k1, _mm_slli_si128(k1, 4)); \
+		k1 = _mm_xor_si128(k1, _mm_slli_si128(k1, 4)); \
+		k1 = _mm_xor_si128(k1, _mm_slli_si128(k1, 4)); \
+		transf_key[n + 1] = k1 = _mm_xor_si128(k1, t); \
+	} while (0)
+
+/* The AES-256 round keys are shared by all candidates for a salt */
+static void set_transf_key(const unsigned char *seed)
 {
-	SHA256_CTX ctx;
-	unsigned char hash[32];
-	int i;
-	AES_KEY akey;
-
-	// First, hash the masterkey
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, masterkey, strlen(masterkey));
-	SHA256_Final(hash, &ctx);
+	__m128i k0, k1, t;
+
+	transf_key[0] = k0 = _mm_loadu_si128((const __m128i*)seed);
+	transf_key[1] = k1 = _mm_loadu_si128((const __m128i*)(seed + 16));
+	KEY_EXP_256(2, 0x01);
+	KEY_EXP_256(4, 0x02);
+	KEY_EXP_256(6, 0x04);
+	KEY_EXP_256(8, 0x08);
+	KEY_EXP_256(10, 0x10);
+	KEY_EXP_256(12, 0x20);
+	KEY_EXP_256(14, 0x40);
+}
 
-	if (csp->version == 2 && cur_salt->have_keyfile == 0) {
-		SHA256_Init(&ctx);
-		SHA256_Update(&ctx, hash, 32);
-		SHA256_Final(hash, &ctx);
+/*
+ * Encrypt both halves of AES_PARA hashes "rounds" times in ECB mode.  The
+ * chains are independent, so interleaving them hides the AESENC latency.
+ */
+static void transform_rounds(unsigned char (*hash)[32], uint32_t rounds)
+{
+	__m128i b[2 * AES_PARA];
+	int i, r;
+
+	for (i = 0; i < 2 * AES_PARA; i++)
+		b[i] = _mm_loadu_si128((__m128i*)hash[i >> 1] + (i & 1));
+
+	while (rounds--) {
+		for (i = 0; i < 2 * AES_PARA; i++)
+			b[i] = _mm_xor_si128(b[i], transf_key[0]);
+		for (r = 1; r < 14; r++)
+		for (i = 0; i < 2 * AES_PARA; i++)
+			b[i] = _mm_aesenc_si128(b[i], transf_key[r]);
+		for (i = 0; i < 2 * AES_PARA; i++)
+			b[i] = _mm_aesenclast_si128(b[i], transf_key[14]);
 	}
 
-	if (cur_salt->have_keyfile) {
-		SHA256_Init(&ctx);
-		SHA256_Update(&ctx, hash, 32);
-		SHA256_Update(&ctx, cur_salt->keyfile, 32);
-		SHA256_Final(hash, &ctx);
-	}
+	for (i = 0; i < 2 * AES_PARA; i++)
+		_mm_storeu_si128((__m128i*)hash[i >> 1] + (i & 1), b[i]);
+}
+#else
+static void set_transf_key(const unsigned char *seed)
+{
+	AES_set_encrypt_key(seed, 256, &transf_key);
+}
+
+static void transform_rounds(unsigned char (*hash)[32], uint32_t rounds)
+{
+	unsigned char *h = hash[0];
+	uint32_t i;
 
-	// Next, encrypt the created hash
-	AES_set_encrypt_key(csp->transf_randomseed, 256, &akey);
-	i = csp->key_transf_rounds >> 2;
+	i = rounds >> 2;
 	while (i--) {
-		AES_encrypt(hash, hash, &akey);
-		AES_encrypt(hash, hash, &akey);
-		AES_encrypt(hash, hash, &akey);
-		AES_encrypt(hash, hash, &akey);
-		AES_encrypt(hash+16, hash+16, &akey);
-		AES_encrypt(hash+16, hash+16, &akey);
-		AES_encrypt(hash+16, hash+16, &akey);
-		AES_encrypt(hash+16, hash+16, &akey);
+		AES_encrypt(h, h, &transf_key);
+		AES_encrypt(h, h, &transf_key);
+		AES_encrypt(h, h, &transf_key);
+		AES_encrypt(h, h, &transf_key);
+		AES_encrypt(h+16, h+16, &transf_key);
+		AES_encrypt(h+16, h+16, &transf_key);
+		AES_encrypt(h+16, h+16, &transf_key);
+		AES_encrypt(h+16, h+16, &transf_key);
 	}
-	i = csp->key_transf_rounds & 3;
+	i = rounds & 3;
 	while (i--) {
-		AES_encrypt(hash, hash, &akey);
-		AES_encrypt(hash+16, hash+16, &akey);
+		AES_encrypt(h, h, &transf_key);
+		AES_encrypt(h+16, h+16, &transf_key);
 	}
+}
+#endif
 
-	// Finally, hash it again...
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, hash, 32);
-	SHA256_Final(hash, &ctx);
+// GenerateKey32 from CompositeKey.cs, for AES_PARA keys at a time
+static void transform_key(char (*masterkey)[PLAINTEXT_LENGTH + 1],
+                          keepass_salt_t *csp,
+                          unsigned char (*final_key)[32])
+{
+	SHA256_CTX ctx;
+	unsigned char hash[AES_PARA][32];
+	int i;
 
-	// ...and hash the result together with the random seed
-	SHA256_Init(&ctx);
-	if (csp->version == 1) {
-		SHA256_Update(&ctx, csp->final_randomseed, 16);
+	for (i = 0; i < AES_PARA; i++) {
+		// First, hash the masterkey
+		SHA256_Init(&ctx);
+		SHA256_Update(&ctx, masterkey[i], strlen(masterkey[i]));
+		SHA256_Final(hash[i], &ctx);
+
+		if (csp->version == 2 && csp->have_keyfile == 0) {
+			SHA256_Init(&ctx);
+			SHA256_Update(&ctx, hash[i], 32);
+			SHA256_Final(hash[i], &ctx);
+		}
+
+		if (csp->have_keyfile) {
+			SHA256_Init(&ctx);
+			SHA256_Update(&ctx, hash[i], 32);
+			SHA256_Update(&ctx, csp->keyfile, 32);
+			SHA256_Final(hash[i], &ctx);
+		}
 	}
-	else {
-		SHA256_Update(&ctx, csp->final_randomseed, 32);
+
+	// Next, encrypt the created hashes
+	transform_rounds(hash, csp->key_transf_rounds);
+
+	for (i = 0; i < AES_PARA; i++) {
+		// Finally, hash it again...
+		SHA256_Init(&ctx);
+		SHA256_Update(&ctx, hash[i], 32);
+		SHA256_Final(hash[i], &ctx);
+
+		// ...and hash the result together with the random seed
+		SHA256_Init(&ctx);
+		if (csp->version == 1) {
+			SHA256_Update(&ctx, csp->final_randomseed, 16);
+		}
+		else {
+			SHA256_Update(&ctx, csp->final_randomseed, 32);
+		}
+		SHA256_Update(&ctx, hash[i], 32);
+		SHA256_Final(final_key[i], &ctx);
 	}
-	SHA256_Update(&ctx, hash, 32);
-	SHA256_Final(final_key, &ctx);
 }
 
 static void init(struct fmt_main *self)
@@ -141,118 +243,115 @@ static void done(void)
 static void set_salt(void *salt)
 {
 	cur_salt = (keepass_salt_t*)salt;
+	set_transf_key(cur_salt->transf_randomseed);
 }
 
-static int crypt_all(int *pcount, struct db_salt *salt)
+/* Returns 1 if final_key decrypts the database */
+static int check_key(unsigned char *final_key)
 {
-	const int count = *pcount;
-	int index = 0;
+	unsigned char *decrypted_content;
+	SHA256_CTX ctx;
+	unsigned char iv[16];
+	unsigned char out[32];
+	int pad_byte;
+	int datasize;
+	AES_KEY akey;
+	Twofish_key tkey;
+	struct chacha_ctx ckey;
+
+	if (cur_salt->algorithm == 0) {
+		/* AES decrypt cur_salt->contents with final_key */
+		memcpy(iv, cur_salt->enc_iv, 16);
+		AES_set_decrypt_key(final_key, 256, &akey);
+	} else if (cur_salt->algorithm == 1) {
+		memcpy(iv, cur_salt->enc_iv, 16);
+		memset(&tkey, 0, sizeof(Twofish_key));
+		Twofish_prepare_key(final_key, 32, &tkey);
+	} else if (cur_salt->algorithm == 2) { // ChaCha20
+		memcpy(iv, cur_salt->enc_iv, 16);
+		chacha_keysetup(&ckey, final_key, 256);
+		chacha_ivsetup(&ckey, iv, NULL, 12);
+	}
 
-	if (any_cracked) {
-		memset(cracked, 0, cracked_size);
-		any_cracked = 0;
+	if (cur_salt->version == 1 && cur_salt->algorithm == 0) {
+		decrypted_content = mem_alloc(cur_salt->contentsize);
+		AES_cbc_encrypt(cur_salt->contents, decrypted_content,
+		                cur_salt->contentsize, &akey, iv, AES_DECRYPT);
+		pad_byte = decrypted_content[cur_salt->contentsize - 1];
+		datasize = cur_salt->contentsize - pad_byte;
+		SHA256_Init(&ctx);
+		SHA256_Update(&ctx, decrypted_content, datasize);
+		SHA256_Final(out, &ctx);
+		MEM_FREE(decrypted_content);
+		if (!memcmp(out, cur_salt->contents_hash, 32))
+			return 1;
 	}
+	else if (cur_salt->version == 2 && cur_salt->algorithm == 0) {
+		unsigned char dec_buf[32];
 
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-	for (index = 0; index < count; index++) {
-		unsigned char final_key[32];
-		unsigned char *decrypted_content;
-		SHA256_CTX ctx;
-		unsigned char iv[16];
-		unsigned char out[32];
-		int pad_byte;
-		int datasize;
-		AES_KEY akey;
-		Twofish_key tkey;
-		struct chacha_ctx ckey;
-
-		// derive and set decryption key
-		transform_key(keepass_key[index], cur_salt, final_key);
-		if (cur_salt->algorithm == 0) {
-			/* AES decrypt cur_salt->contents with final_key */
-			memcpy(iv, cur_salt->enc_iv, 16);
-			AES_set_decrypt_key(final_key, 256, &akey);
-		} else if (cur_salt->algorithm == 1) {
-			memcpy(iv, cur_salt->enc_iv, 16);
-			memset(&tkey, 0, sizeof(Twofish_key));
-			Twofish_prepare_key(final_key, 32, &tkey);
-		} else if (cur_salt->algorithm == 2) { // ChaCha20
-			memcpy(iv, cur_salt->enc_iv, 16);
-			chacha_keysetup(&ckey, final_key, 256);
-			chacha_ivsetup(&ckey, iv, NULL, 12);
-		}
+		AES_cbc_encrypt(cur_salt->contents, dec_buf, 32,
+		                &akey, iv, AES_DECRYPT);
+		if (!memcmp(dec_buf, cur_salt->expected_bytes, 32))
+			return 1;
+	}
+	else if (cur_salt->version == 2 && cur_salt->algorithm == 2) {
+		unsigned char dec_buf[32];
 
-		if (cur_salt->version == 1 && cur_salt->algorithm == 0) {
-			decrypted_content = mem_alloc(cur_salt->contentsize);
-			AES_cbc_encrypt(cur_salt->contents, decrypted_content,
-			                cur_salt->contentsize, &akey, iv, AES_DECRYPT);
-			pad_byte = decrypted_content[cur_salt->contentsize - 1];
-			datasize = cur_salt->contentsize - pad_byte;
+		chacha_decrypt_bytes(&ckey, cur_salt->contents, dec_buf, 32, 20);
+		if (!memcmp(dec_buf, cur_salt->expected_bytes, 32))
+			return 1;
+	}
+	else if (cur_salt->version == 1 && cur_salt->algorithm == 1) { /* KeePass 1.x with Twofish */
+		int crypto_size;
+
+		decrypted_content = mem_alloc(cur_salt->contentsize);
+		crypto_size = Twofish_Decrypt(&tkey, cur_salt->contents,
+		                              decrypted_content,
+		                              cur_salt->contentsize, iv);
+		datasize = crypto_size;  // awesome, right?
+		if (datasize <= cur_salt->contentsize && datasize > 0) {
 			SHA256_Init(&ctx);
 			SHA256_Update(&ctx, decrypted_content, datasize);
 			SHA256_Final(out, &ctx);
-			MEM_FREE(decrypted_content);
-			if (!memcmp(out, cur_salt->contents_hash, 32)) {
-				cracked[index] = 1;
-#ifdef _OPENMP
-#pragma omp atomic
-#endif
-				any_cracked |= 1;
-			}
 		}
-		else if (cur_salt->version == 2 && cur_salt->algorithm == 0) {
-			unsigned char dec_buf[32];
+		MEM_FREE(decrypted_content);
+		if (datasize <= cur_salt->contentsize && datasize > 0 &&
+		    !memcmp(out, cur_salt->contents_hash, 32))
+			return 1;
+	} else {
+		// KeePass version 2 with Twofish is TODO. Twofish support under KeePass version 2
+		// requires a third-party plugin. See http://keepass.info/plugins.html for details.
+		error_msg("KeePass v2 w/ Twofish not supported yet");
+	}
+	return 0;
+}
 
-			AES_cbc_encrypt(cur_salt->contents, dec_buf, 32,
-			                &akey, iv, AES_DECRYPT);
-			if (!memcmp(dec_buf, cur_salt->expected_bytes, 32)) {
-				cracked[index] = 1;
-#ifdef _OPENMP
-#pragma omp atomic
-#endif
-				any_cracked |= 1;
-			}
-		}
-		else if (cur_salt->version == 2 && cur_salt->algorithm == 2) {
-			unsigned char dec_buf[32];
+static int crypt_all(int *pcount, struct db_salt *salt)
+{
+	const int count = *pcount;
+	int index = 0;
+
+	if (any_cracked) {
+		memset(cracked, 0, cracked_size);
+		any_cracked = 0;
+	}
 
-			chacha_decrypt_bytes(&ckey, cur_salt->contents, dec_buf, 32, 20);
-			if (!memcmp(dec_buf, cur_salt->expected_bytes, 32)) {
-				cracked[index] = 1;
 #ifdef _OPENMP
-#pragma omp atomic
+#pragma omp parallel for
 #endif
-				any_cracked |= 1;
-			}
-
-		}
-		else if (cur_salt->version == 1 && cur_salt->algorithm == 1) { /* KeePass 1.x with Twofish */
-			int crypto_size;
-
-			decrypted_content = mem_alloc(cur_salt->contentsize);
-			crypto_size = Twofish_Decrypt(&tkey, cur_salt->contents,
-			                              decrypted_content,
-			                              cur_salt->contentsize, iv);
-			datasize = crypto_size;  // awesome, right?
-			if (datasize <= cur_salt->contentsize && datasize > 0) {
-				SHA256_Init(&ctx);
-				SHA256_Update(&ctx, decrypted_content, datasize);
-				SHA256_Final(out, &ctx);
-				if (!memcmp(out, cur_salt->contents_hash, 32)) {
-					cracked[index] = 1;
+	for (index = 0; index < count; index += AES_PARA) {
+		unsigned char final_key[AES_PARA][32];
+		int i;
+
+		// derive and try the decryption keys
+		transform_key(&keepass_key[index], cur_salt, final_key);
+		for (i = 0; i < AES_PARA; i++)
+		if (check_key(final_key[i])) {
+			cracked[index + i] = 1;
 #ifdef _OPENMP
 #pragma omp atomic
 #endif
-					any_cracked |= 1;
-				}
-			}
-			MEM_FREE(decrypted_content);
-		} else {
-			// KeePass version 2 with Twofish is TODO. Twofish support under KeePass version 2
-			// requires a third-party plugin. See http://keepass.info/plugins.html for details.
-			error_msg("KeePass v2 w/ Twofish not supported yet");
+			any_cracked |= 1;
 		}
 	}
 	return count;
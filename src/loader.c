@@ -278,7 +278,7 @@ void ldr_init_database(struct db_main *db, struct db_options *db_options)
 	db->pw_size = sizeof(struct db_password);
 	db->salt_size = sizeof(struct db_salt);
 	if (!(db_options->flags & DB_WORDS)) {
-		db->pw_size -= sizeof(struct list_main *);
+		db->pw_size -= sizeof(struct list_main *) + sizeof(char *);
 		if (db_options->flags & DB_LOGIN) {
 			if (!options.show_uid_in_cracks)
 				db->pw_size -= sizeof(char *);
@@ -1125,6 +1125,7 @@ static void ldr_load_pw_line(struct db_main *db, char *line)
 			if (!words)
 				words = ldr_init_words(login, gecos, home);
 			current_pw->words = words;
+			current_pw->pairs = NULL;
 		}
 
 		if (db->options->flags & DB_LOGIN) {
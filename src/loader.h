@@ -50,6 +50,10 @@ struct db_password {
 
 /* Words from the GECOS field (loaded for "single crack" mode only) */
 	struct list_main *words;
+
+/* The above words and their pairs as "single crack" mode tries them, built
+ * on first use */
+	char *pairs;
 };
 
 /*
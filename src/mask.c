@@ -13,11 +13,16 @@
 #include <string.h>
 #include <ctype.h>
 
+#define NEED_OS_FORK
+#include "os.h"
+#if OS_FORK
+#include <sys/mman.h>
+#endif
+
 #include "arch.h"
 #include "misc.h" /* for error() */
 #include "logger.h"
 #include "recovery.h"
-#include "os.h"
 #include "signals.h"
 #include "status.h"
 #include "options.h"
@@ -1634,6 +1639,15 @@ static int generate_keys(mask_cpu_context *cpu_mask_ctx,
 	int ps1 = MAX_NUM_MASK_PLHDR, ps2 = MAX_NUM_MASK_PLHDR,
 	    ps3 = MAX_NUM_MASK_PLHDR, ps4 = MAX_NUM_MASK_PLHDR, ps ;
 	int start1, start2, start3, start4;
+	/*
+	 * Keys differing from the previous one only at the first placeholder
+	 * may be passed as a delta, unless they're converted.  With a filter,
+	 * this is possible for as long as it passes the keys unchanged, and it
+	 * is then also given just the changed portion of a key.
+	 */
+	int delta = !mask_has_8bit && !(options.flags & FLG_MASK_STACKED);
+	int unchanged = 0; /* the previous key was passed on as generated */
+	int filtered;
 
 #ifdef MASK_DEBUG
 	fprintf(stderr, "%s(\"%s\")\n", __FUNCTION__, template_key);
@@ -1642,9 +1656,31 @@ static int generate_keys(mask_cpu_context *cpu_mask_ctx,
 #define process_key(key_i)	  \
 	do { \
 		key = key_i; \
-		if (!f_filter || ext_filter_body(key_i, key = key_e)) \
-			if ((crk_process_key(mask_cp_to_utf8(key)))) \
+		filtered = 2; \
+		if (f_filter) \
+			filtered = ext_filter_body(key_i, key = key_e); \
+		unchanged = filtered == 2; \
+		if (filtered && crk_process_key(mask_cp_to_utf8(key))) \
+			return 1; \
+	} while(0)
+
+#define process_key_delta(key_i, pos)	  \
+	do { \
+		if (!delta) \
+			process_key(key_i); \
+		else if (!f_filter) { \
+			if (crk_process_key_delta(key_i, pos)) \
 				return 1; \
+		} else if ((filtered = \
+		    ext_filter_delta(key_i, key_e, pos)) == 2 && unchanged) { \
+			if (crk_process_key_delta(key_i, pos)) \
+				return 1; \
+		} else { \
+			unchanged = filtered == 2; \
+			if (filtered && crk_process_key(unchanged ? \
+			    key_i : key_e)) \
+				return 1; \
+		} \
 	} while(0)
 
 	ps1 = cpu_mask_ctx->ps1;
@@ -1657,6 +1693,7 @@ static int generate_keys(mask_cpu_context *cpu_mask_ctx,
 
 		/* Initialize the placeholders */
 		init_key(ps);
+		ps = -1; /* The first key is always set in full */
 
 		while (1) {
 			if (options.node_count &&
@@ -1667,7 +1704,12 @@ static int generate_keys(mask_cpu_context *cpu_mask_ctx,
 #ifdef MASK_DEBUG
 			fprintf(stderr, "process_key(\"%s\")\n", template_key);
 #endif
-			process_key(template_key);
+			/* Only the first placeholder changed if next_state() stopped there */
+			if (ps == ps1)
+				process_key_delta(template_key,
+				                  ranges(ps1).pos + ranges(ps1).offset);
+			else
+				process_key(template_key);
 			ps = ps1;
 			next_state(ps);
 			if (mask_increments_len && ranges(ps).pos + ranges(ps).offset >= mask_cur_len)
@@ -1699,7 +1741,11 @@ static int generate_keys(mask_cpu_context *cpu_mask_ctx,
 							    !(*my_candidates)--)
 								goto done;
 							set_template_key(ps1, start1);
-							process_key(template_key);
+							if (ranges(ps1).iter)
+								process_key_delta(template_key,
+								                  ranges(ps1).pos + ranges(ps1).offset);
+							else
+								process_key(template_key);
 						}
 					ranges(ps1).iter = 0;
 					}
@@ -1714,6 +1760,7 @@ static int generate_keys(mask_cpu_context *cpu_mask_ctx,
 	}
 done:
 	return 0;
+#undef process_key_delta
 #undef process_key
 }
 
@@ -1844,13 +1891,46 @@ static void skip_position(mask_cpu_context *cpu_mask_ctx, int *arr)
 		}
 }
 
+/*
+ * Number of candidates for current length, not counting any part that is
+ * processed on GPU.
+ */
+static uint64_t mask_keyspace(mask_cpu_context *cpu_mask_ctx)
+{
+	uint64_t total = 1;
+	int ps = cpu_mask_ctx->ps1;
+
+	while(ps < MAX_NUM_MASK_PLHDR) {
+		if (cpu_mask_ctx->ranges[ps].pos < max_keylen)
+			total *= cpu_mask_ctx->ranges[ps].count;
+		ps = cpu_mask_ctx->ranges[ps].next;
+	}
+
+	return total;
+}
+
+/*
+ * Set placeholders for starting at given offset into the keyspace.
+ */
+static void mask_seek(mask_cpu_context *cpu_mask_ctx, uint64_t offset)
+{
+	uint64_t ctr = 1;
+	int ps = cpu_mask_ctx->ps1;
+
+	while(ps < MAX_NUM_MASK_PLHDR) {
+		cpu_mask_ctx->ranges[ps].iter = (offset / ctr) %
+			cpu_mask_ctx->ranges[ps].count;
+		ctr *= cpu_mask_ctx->ranges[ps].count;
+		ps = cpu_mask_ctx->ranges[ps].next;
+	}
+}
+
 /*
  * Divide a work between multiple nodes.  Called by finalize_mask()
  */
 static uint64_t divide_work(mask_cpu_context *cpu_mask_ctx)
 {
-	uint64_t offset, my_candidates, total_candidates, ctr;
-	int ps;
+	uint64_t offset, my_candidates, total_candidates;
 	double fract;
 
 #ifdef MASK_DEBUG
@@ -1860,15 +1940,7 @@ static uint64_t divide_work(mask_cpu_context *cpu_mask_ctx)
 	fract = (double)(options.node_max - options.node_min + 1) /
 		options.node_count;
 
-	offset = 1;
-	ps = cpu_mask_ctx->ps1;
-	while(ps < MAX_NUM_MASK_PLHDR) {
-		if (cpu_mask_ctx->ranges[ps].pos < max_keylen)
-			offset *= cpu_mask_ctx->ranges[ps].count;
-		ps = cpu_mask_ctx->ranges[ps].next;
-	}
-
-	total_candidates = offset;
+	offset = total_candidates = mask_keyspace(cpu_mask_ctx);
 	offset *= fract;
 	my_candidates = offset;
 	offset = my_candidates * (options.node_min - 1);
@@ -1883,18 +1955,231 @@ static uint64_t divide_work(mask_cpu_context *cpu_mask_ctx)
 		error();
 	}
 
-	ctr = 1;
-	ps = cpu_mask_ctx->ps1;
-	while(ps < MAX_NUM_MASK_PLHDR) {
-		cpu_mask_ctx->ranges[ps].iter = (offset / ctr) %
-			cpu_mask_ctx->ranges[ps].count;
-		ctr *= cpu_mask_ctx->ranges[ps].count;
-		ps = cpu_mask_ctx->ranges[ps].next;
-	}
+	mask_seek(cpu_mask_ctx, offset);
 
 	return my_candidates;
 }
 
+#if OS_FORK && defined(MAP_ANON) && defined(__GNUC__)
+/*
+ * With --fork, rather than each process being stuck with its fixed share of
+ * keyspace, the keyspace of all processes together is split in up to
+ * MASK_QUEUE_CHUNKS chunks per length, that they claim from shared memory as
+ * they go.  A chunk is marked done once all of its candidates have been
+ * tried, which we know at the next mask_fix_state().
+ */
+#define MASK_QUEUE			1
+#define MASK_QUEUE_CHUNKS		1024
+#define MASK_QUEUE_WORDS		(MASK_QUEUE_CHUNKS / 64)
+
+struct mask_queue {
+	uint64_t claimed[MASK_QUEUE_WORDS];
+	uint64_t done[MASK_QUEUE_WORDS];
+	unsigned int hint; /* All chunks below this one are claimed */
+};
+
+/* Shared, indexed by length (or 0 when not iterating over lengths) */
+static struct mask_queue *mask_queue;
+/* Our own chunks that are done, but not yet marked done in mask_queue */
+static uint64_t (*queue_pending)[MASK_QUEUE_WORDS];
+static int queue_active, queue_chunk = -1, rec_queue_chunk = -1;
+static int queue_len, rec_queue_len;
+/* Chunk we were on when interrupted, if any */
+static int resume_chunk = -1, resume_chunk_len;
+static unsigned int queue_node_min, queue_node_max;
+
+#define QUEUE_LENGTHS			(PLAINTEXT_BUFFER_SIZE + 1)
+#define queue_index()			(mask_increments_len ? mask_cur_len : 0)
+
+void mask_fork_init(void)
+{
+	unsigned int npf = (options.node_max - options.node_min + 1) / options.fork;
+	void *p;
+
+	if (!(options.flags & FLG_MASK_CHK) ||
+	    (options.flags & FLG_MASK_STACKED))
+		return;
+
+	p = mmap(NULL, QUEUE_LENGTHS * sizeof(*mask_queue),
+	         PROT_READ | PROT_WRITE, MAP_ANON | MAP_SHARED, -1, 0);
+	if (p == MAP_FAILED)
+		return;
+
+	mask_queue = p;
+	queue_pending = mem_calloc(QUEUE_LENGTHS, sizeof(*queue_pending));
+	queue_node_min = options.node_min;
+	queue_node_max = options.node_min + options.fork * npf - 1;
+}
+
+/*
+ * Returns the number of chunks for current length, and (if chunk is not
+ * negative) seeks to that chunk and sets its number of candidates.
+ */
+static unsigned int queue_seek(mask_cpu_context *cpu_mask_ctx, int chunk,
+                               uint64_t *my_candidates)
+{
+	uint64_t total = mask_keyspace(cpu_mask_ctx);
+	uint64_t per_node = total / options.node_count;
+	uint64_t lo = per_node * (queue_node_min - 1);
+	uint64_t hi = (queue_node_max == options.node_count) ?
+		total : per_node * queue_node_max;
+	uint64_t size, base, rem;
+	unsigned int chunks;
+
+	size = hi - lo;
+	chunks = (size < MASK_QUEUE_CHUNKS) ? size : MASK_QUEUE_CHUNKS;
+
+	if (chunk >= 0 && chunks) {
+		base = size / chunks;
+		rem = size % chunks;
+		mask_seek(cpu_mask_ctx,
+		          lo + chunk * base + MIN((unsigned int)chunk, rem));
+		*my_candidates = base + ((unsigned int)chunk < rem);
+	}
+
+	return chunks;
+}
+
+static int queue_claim(int len, unsigned int chunks)
+{
+	struct mask_queue *q = &mask_queue[len];
+	unsigned int c;
+
+	for (c = q->hint; c < chunks; c++) {
+		uint64_t bit = 1ULL << (c & 63);
+
+		if (q->claimed[c >> 6] & bit)
+			continue;
+		if (!(__sync_fetch_and_or(&q->claimed[c >> 6], bit) & bit)) {
+			q->hint = c + 1;
+			return c;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Mark our finished chunks done.  Called when their candidates have all been
+ * tried.
+ */
+static void queue_publish(void)
+{
+	int len, i;
+
+	for (len = 0; len < QUEUE_LENGTHS; len++)
+	for (i = 0; i < MASK_QUEUE_WORDS; i++)
+	if (queue_pending[len][i]) {
+		__sync_fetch_and_or(&mask_queue[len].done[i],
+		                    queue_pending[len][i]);
+		queue_pending[len][i] = 0;
+	}
+}
+
+/*
+ * Generate keys for current length, first finishing any chunk we were on,
+ * then claiming more chunks until there are none left.
+ */
+static int queue_generate_keys(mask_cpu_context *cpu_mask_ctx)
+{
+	int len = queue_index();
+	unsigned int chunks = queue_seek(cpu_mask_ctx, -1, NULL);
+
+	/* Placeholders and cand are as restored */
+	if (resume_chunk >= 0 && resume_chunk_len == len) {
+		queue_chunk = resume_chunk;
+		resume_chunk = -1;
+	}
+
+	queue_len = len;
+	while (1) {
+		if (queue_chunk >= 0) {
+			if (generate_keys(cpu_mask_ctx, &cand))
+				return 1;
+			queue_pending[len][queue_chunk >> 6] |=
+				1ULL << (queue_chunk & 63);
+		}
+		if ((queue_chunk = queue_claim(len, chunks)) < 0)
+			break;
+		queue_seek(cpu_mask_ctx, queue_chunk, &cand);
+	}
+
+	return 0;
+}
+
+void mask_save_queue_state(FILE *file)
+{
+	int len, i;
+
+	if (!queue_active)
+		return;
+
+	fprintf(file, "msk-v1\n%d\n%d\n", rec_queue_len, rec_queue_chunk);
+	for (len = 0; len < QUEUE_LENGTHS; len++) {
+		for (i = 0; i < MASK_QUEUE_WORDS; i++)
+			if (mask_queue[len].done[i])
+				break;
+		if (i == MASK_QUEUE_WORDS)
+			continue;
+		fprintf(file, "%d", len);
+		for (i = 0; i < MASK_QUEUE_WORDS; i++)
+			fprintf(file, " %"PRIx64, mask_queue[len].done[i]);
+		fprintf(file, "\n");
+	}
+	fprintf(file, "-1\n");
+}
+
+int mask_restore_queue_state(FILE *file)
+{
+	int len, chunk, i;
+	uint64_t done;
+
+	if (!mask_queue)
+		return 1;
+
+	if (fscanf(file, "%d\n%d\n", &len, &chunk) != 2 ||
+	    len < 0 || len >= QUEUE_LENGTHS || chunk >= MASK_QUEUE_CHUNKS)
+		return 1;
+
+	queue_active = 1;
+	resume_chunk_len = len;
+	resume_chunk = chunk;
+	if (chunk >= 0)
+		__sync_fetch_and_or(&mask_queue[len].claimed[chunk >> 6],
+		                    1ULL << (chunk & 63));
+
+	while (fscanf(file, "%d", &len) == 1 && len >= 0) {
+		if (len >= QUEUE_LENGTHS)
+			return 1;
+		for (i = 0; i < MASK_QUEUE_WORDS; i++) {
+			if (fscanf(file, " %"SCNx64, &done) != 1)
+				return 1;
+			__sync_fetch_and_or(&mask_queue[len].done[i], done);
+			__sync_fetch_and_or(&mask_queue[len].claimed[i], done);
+		}
+	}
+
+	return 0;
+}
+#else
+#define MASK_QUEUE			0
+#define queue_active			0
+#define queue_generate_keys(ctx)	0
+
+void mask_fork_init(void)
+{
+}
+
+void mask_save_queue_state(FILE *file)
+{
+}
+
+int mask_restore_queue_state(FILE *file)
+{
+	return 1;
+}
+#endif /* OS_FORK && defined(MAP_ANON) && defined(__GNUC__) */
+
 /*
  * When iterating over lengths, The progress shows percent cracked of all
  * lengths up to and including the current one, while the ETA shows the
@@ -1989,6 +2274,14 @@ void mask_fix_state(void)
 	rec_len = mask_cur_len;
 	for (i = 0; i < rec_ctx.count; i++)
 		rec_ctx.ranges[i].iter = cpu_mask_ctx.ranges[i].iter;
+
+#if MASK_QUEUE
+	if (queue_active) {
+		queue_publish();
+		rec_queue_chunk = queue_chunk;
+		rec_queue_len = queue_len;
+	}
+#endif
 }
 
 void remove_slash(char *mask)
@@ -2527,6 +2820,10 @@ void mask_crk_init(struct db_main *db)
 	if (!(options.flags & FLG_MASK_STACKED)) {
 		status_init(get_progress, 0);
 
+#if MASK_QUEUE
+		queue_active = mask_queue && !rec_restored &&
+			cfg_get_bool("Mask", NULL, "ForkWorkQueue", 1);
+#endif
 		rec_restore_mode(mask_restore_state);
 		rec_init(db, mask_save_state);
 
@@ -2545,6 +2842,10 @@ void mask_done()
 		if (!event_abort) {
 			mask_tot_cand = status.cands;
 			cand_length = 0;
+#if MASK_QUEUE
+			if (queue_active)
+				queue_publish();
+#endif
 		}
 		if (!(options.flags & FLG_TEST_CHK)) {
 			crk_done();
@@ -2590,9 +2891,22 @@ int do_mask_crack(const char *extern_key)
 	 * length.
 	 */
 	if (mask_increments_len) {
-		int i;
+		int i, resume_len = 0;
+		uint64_t resume_cand = 0;
 		unsigned int last_mask_sum = int_mask_sum;
 
+		/*
+		 * With the work queue, earlier lengths may have chunks left that
+		 * no process had claimed or marked done as of its last save.
+		 */
+		if (queue_active && restored &&
+		    restored_len > MAX(options.eff_minlength, 1)) {
+			resume_len = restored_len;
+			resume_cand = cand;
+			restored_len = MAX(options.eff_minlength, 1);
+			restored = 0;
+		}
+
 		mask_cur_len = restored_len ?
 			restored_len : options.eff_minlength;
 
@@ -2620,8 +2934,16 @@ int do_mask_crack(const char *extern_key)
 		}
 
 		for (i = mask_cur_len; i <= options.eff_maxlength; i++) {
-			cand_length = rec_cl ? rec_cl - 1 : status.cands;
-			rec_cl = 0;
+			if (i < resume_len) {
+				cand_length = status.cands;
+			} else {
+				cand_length = rec_cl ? rec_cl - 1 : status.cands;
+				rec_cl = 0;
+			}
+			if (i == resume_len) {
+				restored = 1;
+				cand = resume_cand;
+			}
 
 			/* Process remaining keys of last length, if needed */
 			if (!format_cannot_reset && (mask_fmt->params.flags & FMT_MASK)) {
@@ -2669,7 +2991,10 @@ int do_mask_crack(const char *extern_key)
 				if (cfg_get_bool("Mask", NULL, "MaskLengthIterStatus", 1))
 					event_pending = event_status = 1;
 
-				if (generate_keys(&cpu_mask_ctx, &cand))
+				if (queue_active) {
+					if (queue_generate_keys(&cpu_mask_ctx))
+						return 1;
+				} else if (generate_keys(&cpu_mask_ctx, &cand))
 					return 1;
 			}
 		}
@@ -2705,6 +3030,9 @@ int do_mask_crack(const char *extern_key)
 		if (options.flags & FLG_TEST_CHK) {
 			if (bench_generate_keys(&cpu_mask_ctx, &cand))
 				return 1;
+		} else if (queue_active) {
+			if (queue_generate_keys(&cpu_mask_ctx))
+				return 1;
 		} else {
 			if (generate_keys(&cpu_mask_ctx, &cand))
 				return 1;
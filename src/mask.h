@@ -99,6 +99,18 @@ extern void mask_fix_state(void);
 extern void mask_save_state(FILE *file);
 extern int mask_restore_state(FILE *file);
 
+/*
+ * Sets up the work queue that lets --fork'ed processes claim chunks of mask
+ * mode's keyspace on demand.  Called by john_fork() before forking.
+ */
+extern void mask_fork_init(void);
+
+/*
+ * Work queue state, as an appended block of the crash recovery file.
+ */
+extern void mask_save_queue_state(FILE *file);
+extern int mask_restore_queue_state(FILE *file);
+
 /* Evaluate mask_add_len from a given mask string without calling mask_init */
 extern int mask_calc_len(const char *mask);
 
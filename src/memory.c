@@ -659,6 +659,14 @@ alloc_region_t(region_t * region, size_t size)
 	if (flags & MAP_HUGETLB) {
 		flags &= ~MAP_HUGETLB;
 		base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+#ifdef MADV_HUGEPAGE
+/*
+ * No reserved huge pages (the common case), so ask for transparent ones
+ * instead.  This is only a hint, and failure to honor it is harmless.
+ */
+		if (base != MAP_FAILED)
+			madvise(base, size, MADV_HUGEPAGE);
+#endif
 	}
 
 #else
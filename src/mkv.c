@@ -68,13 +68,75 @@ void mkv_hybrid_fix_state(void)
 	hybrid_tidx = gidx;
 }
 
+/*
+ * Whether candidates that only differ from the previous one in the last
+ * character may be passed to the format as such (and whether they then need
+ * to be checked for 8-bit characters), and how many candidates went to the
+ * cracker so far.  A loop over the last character that sees the count
+ * unchanged since its own previous candidate knows nothing else got in
+ * between.
+ */
+static int mkv_delta, mkv_8bit;
+static uint64_t mkv_keys;
+
+static int mkv_process_pwd(struct db_main *db, struct s_pwd *pwd,
+                           uint64_t *sibling)
+{
+	char pass_filtered[PLAINTEXT_BUFFER_SIZE];
+	char *pass = (char *)pwd->password;
+
+	if (gidx > gend)
+		return 1;
+
+	if (pwd->len < gmin_len || pwd->level < gmin_level)
+		return 0;
+
+#if HAVE_REXGEN
+	if (regex) {
+		if (do_regex_hybrid_crack(db, regex, pass,
+		                          regex_case, regex_alpha))
+			return 1;
+		mkv_hybrid_fix_state();
+	} else
+#endif
+	if (f_new) {
+		if (do_external_hybrid_crack(db, pass))
+			return 1;
+		mkv_hybrid_fix_state();
+	} else
+	if (options.flags & FLG_MASK_CHK) {
+		if (do_mask_crack(pass))
+			return 1;
+	} else
+	if (mkv_delta) {
+		int delta = mkv_keys && *sibling == mkv_keys;
+
+		*sibling = ++mkv_keys;
+		if (mkv_8bit) {
+			unsigned char *p = pwd->password;
+
+			while (*p && *p < 0x80)
+				p++;
+			if (*p)
+				delta = *sibling = 0;
+		}
+		if (delta)
+			return crk_process_key_delta(pass, pwd->len - 1);
+		return crk_process_key(pass);
+	} else
+	if (!f_filter ||
+	    ext_filter_body((char *)pwd->password, pass = pass_filtered))
+		return crk_process_key(pass);
+
+	return 0;
+}
+
 static int show_pwd_rnbs(struct db_main *db, struct s_pwd *pwd)
 {
-	uint64_t i;
+	uint64_t i, n;
 	unsigned int k;
 	unsigned long lvl;
-	char pass_filtered[PLAINTEXT_BUFFER_SIZE];
-	char *pass;
+	uint64_t sibling = 0;
 
 	k = 0;
 	i = nbparts[pwd->password[pwd->len - 1] + pwd->len * 256 +
@@ -88,36 +150,16 @@ static int show_pwd_rnbs(struct db_main *db, struct s_pwd *pwd)
 		pwd->level =
 		    lvl + proba2[pwd->password[pwd->len - 2] * 256 +
 		                 pwd->password[pwd->len - 1]];
-		i -= nbparts[pwd->password[pwd->len - 1] + pwd->len * 256 +
-		             pwd->level * 256 * gmax_len];
-		if (pwd->len <= gmax_len) {
+		n = nbparts[pwd->password[pwd->len - 1] + pwd->len * 256 +
+		            pwd->level * 256 * gmax_len];
+		i -= n;
+		/* Only descend if there's anything longer to visit */
+		if (n > 1 && pwd->len <= gmax_len) {
 			if (show_pwd_rnbs(db, pwd))
 				return 1;
 		}
-		if ((pwd->len >= gmin_len) && (pwd->level >= gmin_level)) {
-			pass = (char *)pwd->password;
-#if HAVE_REXGEN
-			if (regex) {
-				if (do_regex_hybrid_crack(db, regex, pass,
-				                          regex_case, regex_alpha))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-#endif
-			if (f_new) {
-				if (do_external_hybrid_crack(db, pass))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-			if (options.flags & FLG_MASK_CHK) {
-				if (do_mask_crack(pass))
-					return 1;
-			} else
-			if (!f_filter ||
-			    ext_filter_body((char *)pwd->password, pass = pass_filtered))
-				if (crk_process_key(pass))
-					return 1;
-		}
+		if (mkv_process_pwd(db, pwd, &sibling))
+			return 1;
 		gidx++;
 		k++;
 		if (gidx > gend)
@@ -131,12 +173,11 @@ static int show_pwd_rnbs(struct db_main *db, struct s_pwd *pwd)
 
 static int show_pwd_r(struct db_main *db, struct s_pwd *pwd, unsigned int bs)
 {
-	uint64_t i;
+	uint64_t i, n;
 	unsigned int k;
 	unsigned long lvl;
 	unsigned char curchar;
-	char pass_filtered[PLAINTEXT_BUFFER_SIZE];
-	char *pass;
+	uint64_t sibling = 0;
 
 	k = 0;
 	i = nbparts[pwd->password[pwd->len - 1] + pwd->len * 256 +
@@ -160,30 +201,8 @@ static int show_pwd_r(struct db_main *db, struct s_pwd *pwd, unsigned int bs)
 				return 1;
 		i -= nbparts[pwd->password[pwd->len - 1] + pwd->len * 256 +
 		             pwd->level * 256 * gmax_len];
-		if ((pwd->len >= gmin_len) && (pwd->level >= gmin_level)) {
-			pass = (char *)pwd->password;
-#if HAVE_REXGEN
-			if (regex) {
-				if (do_regex_hybrid_crack(db, regex, pass,
-				                          regex_case, regex_alpha))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-#endif
-			if (f_new) {
-				if (do_external_hybrid_crack(db, pass))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-			if (options.flags & FLG_MASK_CHK) {
-				if (do_mask_crack(pass))
-					return 1;
-			} else
-			if (!f_filter ||
-			    ext_filter_body((char *)pwd->password, pass = pass_filtered))
-				if (crk_process_key(pass))
-					return 1;
-		}
+		if (mkv_process_pwd(db, pwd, &sibling))
+			return 1;
 		gidx++;
 		k++;
 	}
@@ -194,36 +213,16 @@ static int show_pwd_r(struct db_main *db, struct s_pwd *pwd, unsigned int bs)
 		pwd->level =
 		    lvl + proba2[pwd->password[pwd->len - 2] * 256 +
 		                 pwd->password[pwd->len - 1]];
-		i -= nbparts[pwd->password[pwd->len - 1] + pwd->len * 256 +
-		             pwd->level * 256 * gmax_len];
-		if (pwd->len <= gmax_len) {
+		n = nbparts[pwd->password[pwd->len - 1] + pwd->len * 256 +
+		            pwd->level * 256 * gmax_len];
+		i -= n;
+		/* Only descend if there's anything longer to visit */
+		if (n > 1 && pwd->len <= gmax_len) {
 			if (show_pwd_r(db, pwd, 0))
 				return 1;
 		}
-		if ((pwd->len >= gmin_len) && (pwd->level >= gmin_level)) {
-			pass = (char *)pwd->password;
-#if HAVE_REXGEN
-			if (regex) {
-				if (do_regex_hybrid_crack(db, regex, pass,
-				                          regex_case, regex_alpha))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-#endif
-			if (f_new) {
-				if (do_external_hybrid_crack(db, pass))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-			if (options.flags & FLG_MASK_CHK) {
-				if (do_mask_crack(pass))
-					return 1;
-			} else
-			if (!f_filter ||
-			    ext_filter_body((char *)pwd->password, pass = pass_filtered))
-				if (crk_process_key(pass))
-					return 1;
-		}
+		if (mkv_process_pwd(db, pwd, &sibling))
+			return 1;
 		gidx++;
 		k++;
 		if (gidx > gend)
@@ -239,11 +238,14 @@ static int show_pwd(struct db_main *db, uint64_t start)
 {
 	struct s_pwd pwd;
 	unsigned int i;
-	char pass_filtered[PLAINTEXT_BUFFER_SIZE];
-	char *pass;
+	uint64_t sibling = 0;
 
+/*
+ * Candidates are numbered from 1, so start from the first one through the
+ * same path as when we resume, or the numbering would be off by one.
+ */
 	if (gidx == 0)
-		gidx = start;
+		gidx = start ? start : 1;
 	i = 0;
 
 	if (gidx > 0) {
@@ -256,30 +258,8 @@ static int show_pwd(struct db_main *db, uint64_t start)
 			if (show_pwd_r(db, &pwd, 1))
 				return 1;
 
-			if ((pwd.len >= gmin_len) && (pwd.level >= gmin_level)) {
-				pass = (char *)pwd.password;
-#if HAVE_REXGEN
-				if (regex) {
-					if (do_regex_hybrid_crack(db, regex, pass,
-					                          regex_case, regex_alpha))
-						return 1;
-					mkv_hybrid_fix_state();
-				} else
-#endif
-				if (f_new) {
-					if (do_external_hybrid_crack(db, pass))
-						return 1;
-					mkv_hybrid_fix_state();
-				} else
-				if (options.flags & FLG_MASK_CHK) {
-					if (do_mask_crack(pass))
-						return 1;
-				} else
-				if (!f_filter ||
-				    ext_filter_body((char *)pwd.password, pass = pass_filtered))
-					if (crk_process_key(pass))
-						return 1;
-			}
+			if (mkv_process_pwd(db, &pwd, &sibling))
+				return 1;
 		}
 		gidx++;
 		i++;
@@ -293,30 +273,8 @@ static int show_pwd(struct db_main *db, uint64_t start)
 		pwd.password[1] = 0;
 		if (show_pwd_rnbs(db, &pwd))
 			return 1;
-		if ((pwd.len >= gmin_len) && (pwd.level >= gmin_level)) {
-			pass = (char *)pwd.password;
-#if HAVE_REXGEN
-			if (regex) {
-				if (do_regex_hybrid_crack(db, regex, pass,
-				                          regex_case, regex_alpha))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-#endif
-			if (f_new) {
-				if (do_external_hybrid_crack(db, pass))
-					return 1;
-				mkv_hybrid_fix_state();
-			} else
-			if (options.flags & FLG_MASK_CHK) {
-				if (do_mask_crack(pass))
-					return 1;
-			} else
-			if (!f_filter ||
-			    ext_filter_body((char *)pwd.password, pass = pass_filtered))
-				if (crk_process_key(pass))
-					return 1;
-		}
+		if (mkv_process_pwd(db, &pwd, &sibling))
+			return 1;
 		gidx++;
 		i++;
 	}
@@ -556,6 +514,35 @@ void get_markov_options(struct db_main *db,
 		options.mkv_stats = *statfile;
 }
 
+/*
+ * Whether any character reachable within the Markov level is 8-bit, in which
+ * case keys need checking before being passed as deltas.
+ */
+static int mkv_has_8bit(void)
+{
+	unsigned int i, j;
+
+	for (i = 0x80; i < 0x100; i++) {
+		if (proba1[i] <= gmax_level)
+			return 1;
+		for (j = 0; j < 0x100; j++)
+			if (proba2[j * 256 + i] <= gmax_level)
+				return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * The first n of count equal shares of size, computed without overflow.
+ */
+static uint64_t mkv_share(uint64_t size, unsigned int n)
+{
+	uint64_t count = options.node_count;
+
+	return size / count * n + size % count * n / count;
+}
+
 void get_markov_start_end(char *start_token, char *end_token,
                           uint64_t mkv_max,
                           uint64_t *mkv_start, uint64_t *mkv_end)
@@ -696,6 +683,14 @@ void do_markov_crack(struct db_main *db, char *mkv_param)
 
 	nb_parts(0, 0, 0, mkv_level, mkv_maxlen);
 
+	mkv_delta = !f_filter && !f_new && !(options.flags & FLG_MASK_CHK);
+	mkv_8bit = mkv_has_8bit();
+#if HAVE_REXGEN
+	if (regex)
+		mkv_delta = 0;
+#endif
+	mkv_keys = 0;
+
 	get_markov_start_end(start_token, end_token, nbparts[0], &mkv_start,
 	                     &mkv_end);
 
@@ -710,19 +705,22 @@ void do_markov_crack(struct db_main *db, char *mkv_param)
 		        options.node_count > 1 ? " split over nodes" : "");
 	}
 
+	gend = mkv_end + 10;        /* omg !! */
+
+/*
+ * Nodes get adjacent, non-overlapping ranges whose sizes differ by at most
+ * one.  Only the last node keeps the slack past the end.
+ */
 	if (options.node_count > 1) {
-		uint64_t mkv_size;
+		uint64_t mkv_size = mkv_end - mkv_start + 1;
 
-		mkv_size = mkv_end - mkv_start + 1;
 		if (options.node_max != options.node_count)
-			mkv_end =
-			    mkv_start + mkv_size / options.node_count * options.node_max -
-			    1;
-		mkv_start += mkv_size / options.node_count * (options.node_min - 1);
+			gend = mkv_end = mkv_start +
+			    mkv_share(mkv_size, options.node_max) - 1;
+		mkv_start += mkv_share(mkv_size, options.node_min - 1);
 	}
 
 	gstart = mkv_start;
-	gend = mkv_end + 10;        /* omg !! */
 
 	log_event("Proceeding with Markov mode%s%s",
 	          param ? " " : "", param ? param : "");
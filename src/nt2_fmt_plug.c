@@ -552,6 +552,32 @@ bailout:
 #endif
 }
 
+// Copy previous key and patch one (7-bit) character
+static void set_key_delta(char *key, int pos, int index)
+{
+#ifdef SIMD_COEF_32
+	unsigned int *src = buf_ptr[index - 1];
+	unsigned int *dst = buf_ptr[index];
+	unsigned int i;
+
+	for (i = 0; i < 16 * SIMD_COEF_32; i += SIMD_COEF_32)
+		dst[i] = src[i];
+
+	if (pos < PLAINTEXT_LENGTH) {
+		dst += (pos >> 1) * SIMD_COEF_32;
+		if (pos & 1)
+			*dst = (*dst & 0xffff) | ((unsigned char)key[pos] << 16);
+		else
+			*dst = (*dst & 0xffff0000) | (unsigned char)key[pos];
+	}
+#else
+	memcpy(saved_key[index], saved_key[index - 1], saved_len[index - 1] + 2);
+	saved_len[index] = saved_len[index - 1];
+	if (pos < PLAINTEXT_LENGTH)
+		((UTF8*)saved_key[index])[pos << 1] = key[pos];
+#endif
+}
+
 static char *get_key(int index)
 {
 #ifdef SIMD_COEF_32
@@ -764,7 +790,8 @@ struct fmt_main fmt_NT2 = {
 		},
 		cmp_all,
 		cmp_one,
-		cmp_exact
+		cmp_exact,
+		set_key_delta
 	}
 };
 
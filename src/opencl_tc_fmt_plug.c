@@ -28,6 +28,7 @@ john_register_one(&FMT_STRUCT);
 #include "crc32.h"
 #include "johnswap.h"
 #include "aes.h"
+#define OPENCL_FORMAT
 #include "pbkdf2_hmac_ripemd160.h"
 #include "loader.h"
 #include "opencl_common.h"
@@ -370,6 +370,17 @@ extern unsigned int password_hash_thresholds[PASSWORD_HASH_SIZES];
 #define CRK_PREFETCH			0
 #endif
 
+/*
+ * How many candidate passwords the duplicate candidate suppressor may hold
+ * back while their filter buckets are being prefetched.  Set this to 0 to
+ * disable prefetching (and holding back).
+ */
+#ifdef __SSE__
+#define SUPPRESSOR_PREFETCH		8
+#else
+#define SUPPRESSOR_PREFETCH		0
+#endif
+
 /*
  * How many warnings about suboptimal batch size to emit before suppressing
  * further ones. (You can override this figure with MaxKPCWarnings in
@@ -393,6 +404,14 @@ extern unsigned int password_hash_thresholds[PASSWORD_HASH_SIZES];
  */
 #define SINGLE_MAX_WORD_BUFFER		4
 
+/*
+ * With --node or --fork, single mode splits salts rather than rules between
+ * nodes when there are at least this many salts per node.  Each node then
+ * only needs word buffers for its own share of salts.  This can be changed
+ * in john.conf.
+ */
+#define SINGLE_SPLIT_SALTS_MIN		64
+
 /*
  * Charset parameters.
  *
@@ -23,7 +23,9 @@
 #define JOHN_PBKDF2_HMAC_RIPEMD160_H
 
 #include <string.h>
+#include "arch.h"
 #include "sph_ripemd.h"
+#include "simd-intrinsics.h"
 
 #if (AC_BUILT && HAVE_RIPEMD160) && 0
 // actually, built in sph_ripemd160 may be faster than oSSL build :(
@@ -64,6 +66,8 @@ static void _pbkdf2_ripemd160_load_hmac(const unsigned char *K, int KL, sph_ripe
 	sph_ripemd160(pOpad, opad, RIPEMD160_CBLOCK);
 }
 
+#if !defined(SIMD_COEF_32) || defined(OPENCL_FORMAT)
+
 static void _pbkdf2_ripemd160(const unsigned char *S, int SL, int R, uint32_t *out,
 	                     unsigned char loop, const sph_ripemd160_context *pIpad, const sph_ripemd160_context *pOpad) {
 	sph_ripemd160_context ctx;
@@ -122,3 +126,110 @@ static void pbkdf2_ripemd160(const unsigned char *K, int KL, const unsigned char
 }
 
 #endif
+
+#if defined(SIMD_COEF_32) && !defined(OPENCL_FORMAT)
+
+#define SSE_GROUP_SZ_RIPEMD160 SIMD_COEF_32
+#define RIPEMD160_BUF_SIZ 16
+
+static void _pbkdf2_ripemd160_sse_load_hmac(const unsigned char *K[SSE_GROUP_SZ_RIPEMD160], int KL[SSE_GROUP_SZ_RIPEMD160], sph_ripemd160_context pIpad[SSE_GROUP_SZ_RIPEMD160], sph_ripemd160_context pOpad[SSE_GROUP_SZ_RIPEMD160])
+{
+	int j;
+
+	for (j = 0; j < SSE_GROUP_SZ_RIPEMD160; ++j)
+		_pbkdf2_ripemd160_load_hmac(K[j], KL[j], &pIpad[j], &pOpad[j]);
+}
+
+static void pbkdf2_ripemd160_sse(const unsigned char *K[SSE_GROUP_SZ_RIPEMD160], int KL[SSE_GROUP_SZ_RIPEMD160], const unsigned char *S, int SL, int R, unsigned char *out[SSE_GROUP_SZ_RIPEMD160], int outlen, int skip_bytes)
+{
+	unsigned char tmp_hash[RIPEMD160_DIGEST_LENGTH];
+	uint32_t *i1, *i2, *o1, *ptmp;
+	unsigned int i, j;
+	uint32_t dgst[SSE_GROUP_SZ_RIPEMD160][RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t)];
+	int loops, accum=0;
+	unsigned char loop;
+	sph_ripemd160_context ipad[SSE_GROUP_SZ_RIPEMD160], opad[SSE_GROUP_SZ_RIPEMD160], ctx;
+
+	JTR_ALIGN(MEM_ALIGN_SIMD) uint32_t sse_hash1[RIPEMD160_BUF_SIZ*SSE_GROUP_SZ_RIPEMD160];
+	JTR_ALIGN(MEM_ALIGN_SIMD) uint32_t sse_crypt1[RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t)*SSE_GROUP_SZ_RIPEMD160];
+	JTR_ALIGN(MEM_ALIGN_SIMD) uint32_t sse_crypt2[RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t)*SSE_GROUP_SZ_RIPEMD160];
+	i1 = sse_crypt1;
+	i2 = sse_crypt2;
+	o1 = sse_hash1;
+
+	// Set up the constant second half of the data buffer once: 0x80 after
+	// the 20 byte hash, then the bit count of 64+20 bytes.  RIPEMD-160 is
+	// little-endian just like MD4, so no byte swapping is needed.
+	for (i = 0; i < SIMD_COEF_32; ++i)
+		o1[(RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t))*SIMD_COEF_32 + i] = 0x80;
+	for (i = (RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t)+1)*SIMD_COEF_32; i < 14*SIMD_COEF_32; ++i)
+		o1[i] = 0;
+	for (i = 0; i < SIMD_COEF_32; ++i) {
+		o1[14*SIMD_COEF_32 + i] = ((64+RIPEMD160_DIGEST_LENGTH)<<3);
+		o1[15*SIMD_COEF_32 + i] = 0;
+	}
+
+	_pbkdf2_ripemd160_sse_load_hmac(K, KL, ipad, opad);
+	for (j = 0; j < SSE_GROUP_SZ_RIPEMD160; ++j) {
+		for (i = 0; i < RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t); ++i) {
+			i1[i*SIMD_COEF_32 + j] = ipad[j].val[i];
+			i2[i*SIMD_COEF_32 + j] = opad[j].val[i];
+		}
+	}
+
+	loops = (skip_bytes + outlen + (RIPEMD160_DIGEST_LENGTH-1)) / RIPEMD160_DIGEST_LENGTH;
+	loop = skip_bytes / RIPEMD160_DIGEST_LENGTH + 1;
+	skip_bytes %= RIPEMD160_DIGEST_LENGTH;
+
+	while (loop <= loops) {
+		unsigned int k;
+		for (j = 0; j < SSE_GROUP_SZ_RIPEMD160; ++j) {
+			memcpy(&ctx, &ipad[j], sizeof(ctx));
+			sph_ripemd160(&ctx, S, SL);
+			sph_ripemd160(&ctx, "\x0\x0\x0", 3);
+			sph_ripemd160(&ctx, &loop, 1);
+			sph_ripemd160_close(&ctx, tmp_hash);
+
+			memcpy(&ctx, &opad[j], sizeof(ctx));
+			sph_ripemd160(&ctx, tmp_hash, RIPEMD160_DIGEST_LENGTH);
+			sph_ripemd160_close(&ctx, tmp_hash);
+
+			// sph_ripemd160_close() re-inits the context, so take the
+			// state words from the (little-endian) digest bytes.
+			for (i = 0; i < RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t); ++i)
+				o1[i*SIMD_COEF_32 + j] = dgst[j][i] =
+					(uint32_t)tmp_hash[i*4] |
+					(uint32_t)tmp_hash[i*4+1] << 8 |
+					(uint32_t)tmp_hash[i*4+2] << 16 |
+					(uint32_t)tmp_hash[i*4+3] << 24;
+		}
+
+		// Here is the inner loop.  We loop from 1 to count.  iteration 0 was done in the ipad/opad computation.
+		for (i = 1; i < R; i++) {
+			SIMDripemd160body((vtype*)o1, o1, i1, SSEi_MIXED_IN|SSEi_RELOAD|SSEi_OUTPUT_AS_INP_FMT);
+			SIMDripemd160body((vtype*)o1, o1, i2, SSEi_MIXED_IN|SSEi_RELOAD|SSEi_OUTPUT_AS_INP_FMT);
+			for (k = 0; k < SSE_GROUP_SZ_RIPEMD160; k++) {
+				ptmp = &o1[k];
+				for (j = 0; j < (RIPEMD160_DIGEST_LENGTH/sizeof(uint32_t)); j++)
+					dgst[k][j] ^= ptmp[j*SIMD_COEF_32];
+			}
+		}
+
+		for (i = skip_bytes; i < RIPEMD160_DIGEST_LENGTH && accum < outlen; ++i) {
+			for (j = 0; j < SSE_GROUP_SZ_RIPEMD160; ++j) {
+#if ARCH_LITTLE_ENDIAN
+				out[j][accum] = ((unsigned char*)(dgst[j]))[i];
+#else
+				out[j][accum] = ((unsigned char*)(dgst[j]))[i^3];
+#endif
+			}
+			++accum;
+		}
+		++loop;
+		skip_bytes = 0;
+	}
+}
+
+#endif
+
+#endif /* JOHN_PBKDF2_HMAC_RIPEMD160_H */
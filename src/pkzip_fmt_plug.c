@@ -36,9 +36,30 @@ john_register_one(&fmt_pkzip);
 #include "pkzip_inffixed.h"  // This file is a data file, taken from zlib
 #include "loader.h"
 
+/*
+ * The ZipCrypto key schedule and the first checksum test are run for a
+ * vector of candidates at once, using gathers for the CRC table lookups.
+ */
+#if !defined(JOHN_NO_SIMD) && (defined(__AVX512F__) || defined(__AVX2__))
+#include "pseudo_intrinsics.h"
+#if defined(__AVX512F__)
+#define PKZ_SIMD            16
+#else
+#define PKZ_SIMD            8
+#endif
+#else
+#define PKZ_SIMD            0
+#endif
+
 #define FORMAT_LABEL        "PKZIP"
 #define FORMAT_NAME         ""
+#if PKZ_SIMD == 16
+#define ALGORITHM_NAME      "512/512 AVX512F 16x"
+#elif PKZ_SIMD == 8
+#define ALGORITHM_NAME      "256/256 AVX2 8x"
+#else
 #define ALGORITHM_NAME      "32/" ARCH_BITS_STR
+#endif
 #define FORMAT_TAG          "$pkzip$"
 #define FORMAT_TAG2         "$pkzip2$"
 #define FORMAT_TAG_LEN      (sizeof(FORMAT_TAG)-1)
@@ -1335,6 +1356,127 @@ MAYBE_INLINE static int check_inflate_CODE1(u8 *next, int left)
 		}
 #endif
 
+#if PKZ_SIMD
+#define PKZ_SIMD_UPDATE(c) \
+	do { \
+		key0 = vxor(vgather_epi32(JTR_CRC32_table, \
+		    vand(vxor(key0, c), mask_ff), 4), vsrli_epi32(key0, 8)); \
+		key1 = vadd_epi32(vmullo_epi32(vadd_epi32(key1, \
+		    vand(key0, mask_ff)), mult), one); \
+		key2 = vxor(vgather_epi32(JTR_CRC32_table, \
+		    vand(vxor(key2, vsrli_epi32(key1, 24)), mask_ff), 4), \
+		    vsrli_epi32(key2, 8)); \
+	} while (0)
+
+/* The vector counterpart of PKZ_MULT(), without the table */
+#define PKZ_SIMD_MULT(c, b) \
+	do { \
+		vtype t = vor(vand(key2, mask_ffff), two); \
+		c = vxor(b, vand(vsrli_epi32(vmullo_epi32(t, vxor(t, one)), 8), \
+		    mask_ff)); \
+	} while (0)
+
+/*
+ * Computes the password keys into K12[] for the PKZ_SIMD candidates from
+ * idx on.  Just like the scalar code, an empty password processes its
+ * terminating NUL.
+ */
+static void pkz_simd_keys(int idx, int count)
+{
+	const vtype mask_ff = vset1_epi32(0xff);
+	const vtype mult = vset1_epi32(134775813);
+	const vtype one = vset1_epi32(1);
+	uint32_t JTR_ALIGN(MEM_ALIGN_SIMD) c[PKZ_SIMD];
+	uint32_t JTR_ALIGN(MEM_ALIGN_SIMD) active[PKZ_SIMD];
+	uint32_t JTR_ALIGN(MEM_ALIGN_SIMD) k[3][PKZ_SIMD];
+	int len[PKZ_SIMD];
+	int i, pos, max_len = 1;
+	vtype key0, key1, key2;
+
+	for (i = 0; i < PKZ_SIMD; i++) {
+		len[i] = 0;
+		if (idx + i < count && !(len[i] = strlen(saved_key[idx + i])))
+			len[i] = 1;
+		if (len[i] > max_len)
+			max_len = len[i];
+	}
+
+	key0 = vset1_epi32(0x12345678UL);
+	key1 = vset1_epi32(0x23456789UL);
+	key2 = vset1_epi32(0x34567890UL);
+
+	for (pos = 0; pos < max_len; pos++) {
+		vtype k0 = key0, k1 = key1, k2 = key2, mask;
+
+		for (i = 0; i < PKZ_SIMD; i++) {
+			active[i] = pos < len[i] ? 0xffffffff : 0;
+			c[i] = active[i] ? (u8)saved_key[idx + i][pos] : 0;
+		}
+		PKZ_SIMD_UPDATE(vload(c));
+		mask = vload(active);
+		key0 = vcmov(key0, k0, mask);
+		key1 = vcmov(key1, k1, mask);
+		key2 = vcmov(key2, k2, mask);
+	}
+
+	vstore(k[0], key0);
+	vstore(k[1], key1);
+	vstore(k[2], key2);
+	for (i = 0; i < PKZ_SIMD && idx + i < count; i++) {
+		K12[(idx + i) * 3] = k[0][i];
+		K12[(idx + i) * 3 + 1] = k[1][i];
+		K12[(idx + i) * 3 + 2] = k[2][i];
+	}
+}
+
+/*
+ * Decrypts the 12 byte encryption header of the salt's first hash for the
+ * PKZ_SIMD candidates from idx on, and sets chk[] for those that pass the
+ * checksum byte(s).  Only these go on to the scalar checks in crypt_all().
+ */
+static void pkz_simd_check(int idx, int count)
+{
+	const vtype mask_ff = vset1_epi32(0xff);
+	const vtype mask_ffff = vset1_epi32(0xffff);
+	const vtype mult = vset1_epi32(134775813);
+	const vtype one = vset1_epi32(1);
+	const vtype two = vset1_epi32(2);
+	uint32_t JTR_ALIGN(MEM_ALIGN_SIMD) c10[PKZ_SIMD];
+	uint32_t JTR_ALIGN(MEM_ALIGN_SIMD) c11[PKZ_SIMD];
+	uint32_t JTR_ALIGN(MEM_ALIGN_SIMD) k[3][PKZ_SIMD];
+	const u8 *b = salt->H[0].h;
+	u16 e = salt->H[0].c;
+	u16 e2 = salt->H[0].type == 2 ? salt->H[0].c2 : e;
+	int i;
+	vtype key0, key1, key2, c;
+
+	for (i = 0; i < PKZ_SIMD; i++) {
+		int j = idx + i < count ? idx + i : idx;
+
+		k[0][i] = K12[j * 3];
+		k[1][i] = K12[j * 3 + 1];
+		k[2][i] = K12[j * 3 + 2];
+	}
+	key0 = vload(k[0]);
+	key1 = vload(k[1]);
+	key2 = vload(k[2]);
+
+	for (i = 0; i < 11; i++) {
+		PKZ_SIMD_MULT(c, vset1_epi32(b[i]));
+		PKZ_SIMD_UPDATE(c);
+	}
+	vstore(c10, c);
+	PKZ_SIMD_MULT(c, vset1_epi32(b[11]));
+	vstore(c11, c);
+
+	for (i = 0; i < PKZ_SIMD && idx + i < count; i++)
+		chk[idx + i] =
+			(salt->chk_bytes != 2 || c10[i] == (e & 0xff) ||
+			 c10[i] == (e2 & 0xff)) &&
+			(c11[i] == (e >> 8) || c11[i] == (e2 >> 8));
+}
+#endif
+
 /*
  * Crypt_all simply performs the checksum .zip validatation of the data. It performs
  * this for ALL hashes provided. If any of them fail to match, then crypt all puts the
@@ -1363,6 +1505,18 @@ static int crypt_all(int *pcount, struct db_salt *_salt)
 	// Also, since we have 'multiple' files in a .zip file (and multiple checksums), we bail as at the
 	// first time we fail to match checksum.  So, there may be some threads which check more checksums.
 	// Again, hopefully globbing many tests into a threads working set will flatten out these differences.
+#if PKZ_SIMD
+#ifdef _OPENMP
+#pragma omp parallel for private(idx)
+#endif
+	for (idx = 0; idx < _count; idx += PKZ_SIMD) {
+		if (dirty)
+			pkz_simd_keys(idx, _count);
+		pkz_simd_check(idx, _count);
+	}
+	dirty = 0;
+#endif
+
 #ifdef _OPENMP
 #pragma omp parallel for private(idx)
 #endif
@@ -1381,6 +1535,11 @@ static int crypt_all(int *pcount, struct db_salt *_salt)
 		z_stream strm;
 		int ret;
 
+#if PKZ_SIMD
+		/* the vector pass above already rejected most candidates */
+		if (!chk[idx])
+			continue;
+#endif
 		/* use the pwkey for each hash.  We mangle on the 12 bytes of IV to what  was computed in the pwkey load. */
 
 		if (dirty) {
@@ -135,6 +135,8 @@ char *prince_limit_str;
 
 static double progress;
 static char *mem_map, *map_pos, *map_end;
+static unsigned int rec_compat;
+static int node_split;
 #if HAVE_REXGEN
 static char *regex_alpha;
 static int regex_case;
@@ -170,6 +172,10 @@ static char *regex;
 
 #define ENTRY_END_HASH   0xFFFFFFFF
 
+#ifdef JTR_MODE
+#define NODE_CHUNK       0x1000
+#endif
+
 #ifndef JTR_MODE
 #define MIN(a,b) (((a) < (b)) ? (a) : (b))
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
@@ -187,12 +193,6 @@ typedef struct
 
 } pw_order_t;
 
-typedef struct
-{
-  u8   *buf;
-
-} elem_t;
-
 typedef struct
 {
   u8   *buf;
@@ -207,8 +207,6 @@ typedef struct
 {
   u32 next;
 
-  char *element;
-
 } uniq_data_t;
 
 typedef struct
@@ -223,9 +221,14 @@ typedef struct
 
 } uniq_t;
 
+/*
+ * Elements of one length are stored packed back to back, so element i of
+ * db_entries[len] is at elems_buf + i * len.  With dupe suppression, uniq
+ * entry i is element i.
+ */
 typedef struct
 {
-  elem_t  *elems_buf;
+  u8      *elems_buf;
   u64      elems_cnt;
   u64      elems_alloc;
 
@@ -440,34 +443,38 @@ static void usage_big_print (const char *progname)
 #define malloc_tiny(size) mem_alloc_tiny(size, MEM_ALIGN_NONE)
 #endif
 
-static void check_realloc_elems (db_entry_t *db_entry)
+static void realloc_elems (db_entry_t *db_entry, const u64 elems_alloc_new, const int elem_len)
 {
-  if (db_entry->elems_cnt == db_entry->elems_alloc)
-  {
-    const u64 elems_alloc = db_entry->elems_alloc;
-
-    const u64 elems_alloc_new = elems_alloc + ALLOC_NEW_ELEMS;
+  db_entry->elems_buf = (u8 *) realloc (db_entry->elems_buf, elems_alloc_new * elem_len);
 
-    db_entry->elems_buf = (elem_t *) realloc (db_entry->elems_buf, elems_alloc_new * sizeof (elem_t));
-
-    if (db_entry->elems_buf == NULL)
-    {
+  if (db_entry->elems_buf == NULL)
+  {
 #ifdef JTR_MODE
-      fprintf (stderr, "Out of memory trying to allocate "Zu" bytes\n", (size_t) elems_alloc_new * sizeof (elem_t));
+    fprintf (stderr, "Out of memory trying to allocate "Zu" bytes\n", (size_t) elems_alloc_new * elem_len);
 #else
-      fprintf (stderr, "Out of memory trying to allocate %zu bytes\n", (size_t) elems_alloc_new * sizeof (elem_t));
+    fprintf (stderr, "Out of memory trying to allocate %zu bytes\n", (size_t) elems_alloc_new * elem_len);
 #endif
 
 #ifndef JTR_MODE
-      exit (-1);
+    exit (-1);
 #else
-      error();
+    error();
 #endif
-    }
+  }
 
-    memset (&db_entry->elems_buf[elems_alloc], 0, ALLOC_NEW_ELEMS * sizeof (elem_t));
+  db_entry->elems_alloc = elems_alloc_new;
+}
 
-    db_entry->elems_alloc = elems_alloc_new;
+static void check_realloc_elems (db_entry_t *db_entry, const int elem_len)
+{
+  if (db_entry->elems_cnt == db_entry->elems_alloc)
+  {
+    const u64 elems_alloc = db_entry->elems_alloc;
+
+    /* grow by an eighth, so huge wordlists don't take a copy per ALLOC_NEW_ELEMS */
+    const u64 elems_alloc_new = elems_alloc + MAX (ALLOC_NEW_ELEMS, elems_alloc / 8);
+
+    realloc_elems (db_entry, elems_alloc_new, elem_len);
   }
 }
 
@@ -673,7 +680,7 @@ static void chain_set_pwbuf_init (const chain_t *chain_buf, const db_entry_t *db
 
     const u64 elems_idx = cur_chain_ks_poses[idx];
 
-    memcpy (pw_buf, db_entry->elems_buf[elems_idx].buf, db_key);
+    memcpy (pw_buf, db_entry->elems_buf + elems_idx * db_key, db_key);
 
     pw_buf += db_key;
   }
@@ -699,14 +706,14 @@ static void chain_set_pwbuf_increment (const chain_t *chain_buf, const db_entry_
 
     if (elems_idx < elems_cnt)
     {
-      memcpy (pw_buf, db_entry->elems_buf[elems_idx].buf, db_key);
+      memcpy (pw_buf, db_entry->elems_buf + elems_idx * db_key, db_key);
 
       break;
     }
 
     cur_chain_ks_poses[idx] = 0;
 
-    memcpy (pw_buf, db_entry->elems_buf[0].buf, db_key);
+    memcpy (pw_buf, db_entry->elems_buf, db_key);
 
     pw_buf += db_key;
   }
@@ -739,32 +746,13 @@ static void chain_gen_with_idx (chain_t *chain_buf, const int len1, const int ch
   chain_buf->cnt++;
 }
 
-static char *add_elem (db_entry_t *db_entry, char *input_buf, int input_len)
+static void add_elem (db_entry_t *db_entry, char *input_buf, int input_len)
 {
-  check_realloc_elems (db_entry);
-
-  elem_t *elem_buf = &db_entry->elems_buf[db_entry->elems_cnt];
+  check_realloc_elems (db_entry, input_len);
 
-#ifndef JTR_MODE
-  elem_buf->buf = malloc_tiny (input_len);
-
-  memcpy (elem_buf->buf, input_buf, input_len);
-#else
-  if (mem_map && options.input_enc == options.target_enc)
-  {
-    elem_buf->buf = (u8*)input_buf;
-  }
-  else
-  {
-    elem_buf->buf = malloc_tiny (input_len);
-
-    memcpy (elem_buf->buf, input_buf, input_len);
-  }
-#endif
+  memcpy (db_entry->elems_buf + db_entry->elems_cnt * input_len, input_buf, input_len);
 
   db_entry->elems_cnt++;
-
-  return (char *) elem_buf->buf;
 }
 
 static u32 input_hash (char *input_buf, int input_len, const int hash_mask)
@@ -791,7 +779,7 @@ static void add_uniq (db_entry_t *db_entry, char *input_buf, int input_len)
 
   while (cur != ENTRY_END_HASH)
   {
-    if (memcmp (input_buf, uniq->data[cur].element, input_len) == 0) return;
+    if (memcmp (input_buf, db_entry->elems_buf + (u64) cur * input_len, input_len) == 0) return;
 
     prev = cur;
 
@@ -816,8 +804,9 @@ static void add_uniq (db_entry_t *db_entry, char *input_buf, int input_len)
     uniq->data = realloc (uniq->data, uniq->alloc * sizeof (uniq_data_t));
   }
 
-  uniq->data[index].element = add_elem (db_entry, input_buf, input_len);
-  uniq->data[index].next    = ENTRY_END_HASH;
+  add_elem (db_entry, input_buf, input_len);
+
+  uniq->data[index].next = ENTRY_END_HASH;
 
   uniq->index++;
 }
@@ -858,6 +847,9 @@ static void save_state(FILE *file)
 
   mpz_fdiv_q_2exp(half, rec_pos, 64); // upper 64 bits
   fprintf(file, "%"PRIu64"\n", (uint64_t)mpz_get_ui(half));
+
+  if (node_split)
+    fprintf(file, "pp-v%u\n", rec_compat);
 }
 
 static int restore_state(FILE *file)
@@ -876,6 +868,15 @@ static int restore_state(FILE *file)
   mpz_add(rec_pos, rec_pos, hi);
   mpz_clear(hi);
 
+/*
+ * Sessions that split the keyspace between nodes in whole blocks, like we
+ * did before, have no version line here and are continued the old way.
+ */
+  rec_compat = 1;
+  if (ungetc(getc(file), file) == 'p' &&
+      fscanf(file, "pp-v%u\n", &rec_compat) != 1)
+    return 1;
+
   return 0;
 }
 
@@ -913,6 +914,53 @@ static double get_progress(void)
   return progress;
 }
 
+/*
+ * With --node or --fork, keyspace positions are dealt out to the nodes in
+ * round-robin chunks of NODE_CHUNK candidates.  This gives each node an even
+ * share of every chain while all of them move through the chains in the same
+ * order, and the split only depends on the position, so it survives --skip,
+ * --limit and restoring at any point.  Returns the first position at or after
+ * iter_pos that is ours (iter_max if none are), with the chain positioned
+ * there, and sets *iter_end to where our run of chunks ends.
+ */
+static u64 node_seek (const chain_t *chain_buf, const db_entry_t *db_entries, u64 cur_chain_ks_poses[OUT_LEN_MAX], mpz_t total_ks_pos, u64 iter_pos, const u64 iter_max, u64 *iter_end)
+{
+  const u32 node_count = options.node_count;
+
+  mpz_t pos; mpz_init (pos);
+
+  mpz_add_ui (pos, total_ks_pos, iter_pos);
+
+  u64 off = mpz_fdiv_ui (pos, NODE_CHUNK);
+
+  mpz_fdiv_q_ui (pos, pos, NODE_CHUNK);
+
+  u32 node = mpz_fdiv_ui (pos, node_count) + 1;
+
+  if (node < options.node_min || node > options.node_max)
+  {
+    const u64 gap = (u64)((options.node_min + node_count - node) % node_count) * NODE_CHUNK - off;
+
+    iter_pos = (gap < iter_max - iter_pos) ? iter_pos + gap : iter_max;
+
+    node = options.node_min;
+
+    off = 0;
+
+    mpz_add_ui (pos, chain_buf->ks_pos, iter_pos);
+
+    set_chain_ks_poses (chain_buf, db_entries, &pos, cur_chain_ks_poses);
+  }
+
+  const u64 run = (u64)(options.node_max - node + 1) * NODE_CHUNK - off;
+
+  *iter_end = (run < iter_max - iter_pos) ? iter_pos + run : iter_max;
+
+  mpz_clear (pos);
+
+  return iter_pos;
+}
+
 static int get_bits(mpz_t *op)
 {
   mpz_t half; mpz_init(half);
@@ -1619,6 +1667,15 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
     {
       input_buf = mgets(&input_len);
       if (input_buf == NULL) break;
+
+      /*
+       * Lines in the mapping aren't NUL terminated, and the strchr() and
+       * UTF-8 checks below would otherwise scan the rest of the file.
+       */
+      input_len = MIN(input_len, (int) sizeof (buf) - 1);
+      memcpy (buf, input_buf, input_len);
+      buf[input_len] = 0;
+      input_buf = buf;
     }
     else
     {
@@ -1742,6 +1799,26 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
     fclose (read_fp);
   }
 
+#if defined(JTR_MODE) && defined(HAVE_MMAP)
+  /* elements were copied out, so the mapping is no longer needed */
+  if (mem_map)
+  {
+    munmap (mem_map, file_len);
+
+    mem_map = NULL;
+  }
+#endif
+
+  for (int pw_len = IN_LEN_MIN; pw_len <= MIN(IN_LEN_MAX, pw_max); pw_len++)
+  {
+    db_entry_t *db_entry = &db_entries[pw_len];
+
+    if (db_entry->elems_cnt && db_entry->elems_cnt < db_entry->elems_alloc)
+    {
+      realloc_elems (db_entry, db_entry->elems_cnt, pw_len);
+    }
+  }
+
   if (dupe_check)
   {
     int in_max = MIN(IN_LEN_MAX, pw_max);
@@ -1885,9 +1962,12 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
 #ifdef JTR_MODE
   status_init(get_progress, 0);
 
+  rec_compat = 2;
   rec_restore_mode(restore_state);
   rec_init(db, save_state);
 
+  node_split = options.node_count && rec_compat >= 2;
+
   if (mpz_cmp_ui(rec_pos, 0))
   {
     mpz_set(skip, rec_pos);
@@ -1909,8 +1989,7 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
     chain_t *chains_buf = db_entry->chains_buf;
 
 #ifdef JTR_MODE
-    tot_mem += db_entry->elems_alloc * sizeof(elem_t);
-    tot_mem += db_entry->elems_cnt * pw_len;
+    tot_mem += db_entry->elems_alloc * pw_len;
     tot_mem += db_entry->chains_alloc * sizeof(chain_t);
 #endif
     mpz_set_si (tmp, 0);
@@ -2257,7 +2336,7 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
 
 #ifdef JTR_MODE
         u32 for_node, node_skip = 0;
-        if (options.node_count)
+        if (options.node_count && !node_split)
         {
           for_node = mpz_fdiv_ui(total_ks_pos,options.node_count) + 1;
           node_skip = for_node < options.node_min ||
@@ -2281,6 +2360,15 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
             set_chain_ks_poses (chain_buf, db_entries, &tmp, db_entry->cur_chain_ks_poses);
           }
 
+#ifdef JTR_MODE
+          u64 iter_end_u64 = iter_max_u64;
+
+          if (node_split)
+          {
+            iter_pos_u64 = node_seek (chain_buf, db_entries, db_entry->cur_chain_ks_poses, total_ks_pos, iter_pos_u64, iter_max_u64, &iter_end_u64);
+          }
+#endif
+
           chain_set_pwbuf_init (chain_buf, db_entries, db_entry->cur_chain_ks_poses, pw_buf);
 
           const u64 iter_pos_save = iter_max_u64 - iter_pos_u64;
@@ -2361,8 +2449,21 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
             chain_set_pwbuf_increment (chain_buf, db_entries, db_entry->cur_chain_ks_poses, pw_buf);
 
             iter_pos_u64++;
+#ifdef JTR_MODE
+            if (iter_pos_u64 == iter_end_u64 && iter_pos_u64 < iter_max_u64)
+            {
+              iter_pos_u64 = node_seek (chain_buf, db_entries, db_entry->cur_chain_ks_poses, total_ks_pos, iter_pos_u64, iter_max_u64, &iter_end_u64);
+
+              chain_set_pwbuf_init (chain_buf, db_entries, db_entry->cur_chain_ks_poses, pw_buf);
+            }
+#endif
           }
 
+#ifdef JTR_MODE
+          if (node_split)
+            mpz_add (save, total_ks_pos, iter_max);
+          else
+#endif
           mpz_add_ui (save, save, iter_pos_save);
 #ifdef JTR_MODE
           if (jtr_done || event_abort)
@@ -2472,11 +2573,6 @@ void do_prince_crack(struct db_main *db, const char *wordlist, int rules)
 #ifndef JTR_MODE
   return 0;
 #else
-#if defined(HAVE_MMAP)
-  if (mem_map)
-    munmap(mem_map, file_len);
-#endif
-
   crk_done();
   rec_done(event_abort || (status.pass && db->salts));
 
@@ -189,6 +189,7 @@ typedef __m512i vtype;
 #define vgather_epi64(b, i, s)  _mm512_i64gather_epi64(i, (void*)(b), s)
 #define vload(x)                _mm512_load_si512((void*)(x))
 #define vloadu(x)               _mm512_loadu_si512((void*)(x))
+#define vmullo_epi32            _mm512_mullo_epi32
 #define vor                     _mm512_or_si512
 #define vscatter_epi32(b,i,v,s) _mm512_i32scatter_epi32((void*)(b), i, v, s)
 #define vscatter_epi64(b,i,v,s) _mm512_i64scatter_epi64((void*)(b), i, v, s)
@@ -324,6 +325,7 @@ typedef __m256i vtype;
 #define vload(x)                _mm256_load_si256((void*)(x))
 #define vloadu(x)               _mm256_loadu_si256((void*)(x))
 #define vmovemask_epi8          _mm256_movemask_epi8
+#define vmullo_epi32            _mm256_mullo_epi32
 #define vor                     _mm256_or_si256
 #define vpermute2x128           _mm256_permute2x128_si256
 #define vpermute4x64_epi64      _mm256_permute4x64_epi64
@@ -454,6 +456,9 @@ typedef __m128i vtype;
 #define vload(x)                _mm_load_si128((const vtype*)(x))
 #define vloadu(x)               _mm_loadu_si128((const vtype*)(x))
 #define vmovemask_epi8          _mm_movemask_epi8
+#if __SSE4_1__
+#define vmullo_epi32            _mm_mullo_epi32
+#endif
 #define vor                     _mm_or_si128
 #define vpermute4x64_epi64      _mm_permute4x64_epi64
 #define vpermute2x128           _mm_permute2x128_si128
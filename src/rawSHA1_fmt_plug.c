@@ -176,6 +176,7 @@ static int binary_hash_4(void *binary) { return ((uint32_t*)binary)[pos] & PH_MA
 static int binary_hash_5(void *binary) { return ((uint32_t*)binary)[pos] & PH_MASK_5; }
 static int binary_hash_6(void *binary) { return ((uint32_t*)binary)[pos] & PH_MASK_6; }
 
+#define SET_KEY_DELTA
 #include "common-simd-setkey32.h"
 
 static void *get_binary(char *ciphertext)
@@ -378,7 +379,8 @@ struct fmt_main fmt_rawSHA1 = {
 		},
 		cmp_all,
 		cmp_one,
-		cmp_exact
+		cmp_exact,
+		set_key_delta
 	}
 };
 
@@ -442,7 +444,8 @@ struct fmt_main fmt_rawSHA1_axcrypt = {
 		},
 		cmp_all,
 		cmp_one,
-		cmp_exact
+		cmp_exact,
+		set_key_delta
 	}
 };
 
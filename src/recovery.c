@@ -404,6 +404,7 @@ void rec_save(void)
 	if (rec_save_mode) rec_save_mode(rec_file);
 	/* these are 'appended' resume blocks */
 	save_salt_state();
+	mask_save_queue_state(rec_file);
 	if (rec_save_mode2) rec_save_mode2(rec_file);
 	if (rec_save_mode3) rec_save_mode3(rec_file);
 	if (options.flags & FLG_MASK_STACKED)
@@ -678,6 +679,10 @@ void rec_restore_mode(int (*restore_mode)(FILE *file))
 		if (!strcmp(buf, "slt-v2")) {
 			restore_salt_state(2);
 		}
+		if (!strcmp(buf, "msk-v1")) {
+			if (mask_restore_queue_state(rec_file))
+				rec_format_error("mask-queue");
+		}
 		fgetl(buf, sizeof(buf), rec_file);
 	}
 
@@ -561,6 +561,33 @@ static unsigned int tunable_cost_p(void *salt)
 	return (unsigned int) p;
 }
 
+/*
+ * Order salts by cost, largest first.  Salts of equal cost then run back to
+ * back, and since the per-thread yescrypt locals only ever grow, the very
+ * first salt sizes them for the rest of the session.
+ */
+static int salt_compare(const void *x, const void *y)
+{
+	uint64_t m1, m2;
+	unsigned int c1, c2;
+
+	m1 = (uint64_t)tunable_cost_N((void *)x) * tunable_cost_r((void *)x) *
+		tunable_cost_p((void *)x);
+	m2 = (uint64_t)tunable_cost_N((void *)y) * tunable_cost_r((void *)y) *
+		tunable_cost_p((void *)y);
+	if (m1 != m2)
+		return m1 > m2 ? -1 : 1;
+	c1 = tunable_cost_N((void *)x);
+	c2 = tunable_cost_N((void *)y);
+	if (c1 != c2)
+		return c1 > c2 ? -1 : 1;
+	c1 = tunable_cost_r((void *)x);
+	c2 = tunable_cost_r((void *)y);
+	if (c1 != c2)
+		return c1 > c2 ? -1 : 1;
+	return strcmp(x, y);
+}
+
 struct fmt_main fmt_scrypt = {
 	{
 		FORMAT_LABEL,
@@ -609,7 +636,7 @@ struct fmt_main fmt_scrypt = {
 			NULL
 		},
 		salt_hash,
-		NULL,
+		salt_compare,
 		set_salt,
 		set_key,
 		get_key,
@@ -1106,6 +1106,253 @@ void SIMDmd4body(vtype* _data, unsigned int *out, uint32_t *reload_state,
 
 #endif /* SIMD_PARA_MD4 */
 
+#if SIMD_COEF_32
+/*
+ * RIPEMD-160 over SIMD_COEF_32 mixed input buffers (no PARA).  SSEi_RELOAD
+ * takes the state from reload_state as 5 interleaved words.  The result is
+ * stored the same way, which is also the first 5 words of an input buffer,
+ * so SSEi_OUTPUT_AS_INP_FMT needs no special handling.
+ */
+#ifdef vternarylogic
+#define RMD_F1(x, y, z) vternarylogic(x, y, z, 0x96)
+#define RMD_F3(x, y, z) vternarylogic(x, y, z, 0x59)
+#define RMD_F5(x, y, z) vternarylogic(x, y, z, 0x2D)
+#else
+#define RMD_F1(x, y, z) vxor(vxor(x, y), z)
+#define RMD_F3(x, y, z) vxor(vor(x, vxor(y, ones)), z)
+#define RMD_F5(x, y, z) vxor(x, vor(y, vxor(z, ones)))
+#endif
+#define RMD_F2(x, y, z) vcmov(y, z, x)
+#define RMD_F4(x, y, z) vcmov(x, y, z)
+
+#define RMD_STEP(f, a, b, c, d, e, x, k, s)                             \
+	a = vadd_epi32(a, vadd_epi32(f(b, c, d), vadd_epi32(data[x], k))); \
+	a = vadd_epi32(vroti_epi32(a, s), e);                               \
+	c = vroti_epi32(c, 10);
+
+void SIMDripemd160body(vtype *data, uint32_t *out, uint32_t *reload_state,
+                       unsigned SSEi_flags)
+{
+	vtype h[5], a, b, c, d, e, ap, bp, cp, dp, ep, k, kp;
+#ifndef vternarylogic
+	const vtype ones = vset1_epi32(0xffffffff);
+#endif
+
+	if (SSEi_flags & SSEi_RELOAD) {
+		h[0] = vload((vtype*)&reload_state[0*VS32]);
+		h[1] = vload((vtype*)&reload_state[1*VS32]);
+		h[2] = vload((vtype*)&reload_state[2*VS32]);
+		h[3] = vload((vtype*)&reload_state[3*VS32]);
+		h[4] = vload((vtype*)&reload_state[4*VS32]);
+	} else {
+		h[0] = vset1_epi32(0x67452301);
+		h[1] = vset1_epi32(0xefcdab89);
+		h[2] = vset1_epi32(0x98badcfe);
+		h[3] = vset1_epi32(0x10325476);
+		h[4] = vset1_epi32(0xc3d2e1f0);
+	}
+	a = ap = h[0];
+	b = bp = h[1];
+	c = cp = h[2];
+	d = dp = h[3];
+	e = ep = h[4];
+
+/* Round 1 */
+	k = vset1_epi32(0x00000000);
+	kp = vset1_epi32(0x50A28BE6);
+	RMD_STEP(RMD_F1, a, b, c, d, e,  0, k, 11)
+	RMD_STEP(RMD_F5, ap, bp, cp, dp, ep,  5, kp,  8)
+	RMD_STEP(RMD_F1, e, a, b, c, d,  1, k, 14)
+	RMD_STEP(RMD_F5, ep, ap, bp, cp, dp, 14, kp,  9)
+	RMD_STEP(RMD_F1, d, e, a, b, c,  2, k, 15)
+	RMD_STEP(RMD_F5, dp, ep, ap, bp, cp,  7, kp,  9)
+	RMD_STEP(RMD_F1, c, d, e, a, b,  3, k, 12)
+	RMD_STEP(RMD_F5, cp, dp, ep, ap, bp,  0, kp, 11)
+	RMD_STEP(RMD_F1, b, c, d, e, a,  4, k,  5)
+	RMD_STEP(RMD_F5, bp, cp, dp, ep, ap,  9, kp, 13)
+	RMD_STEP(RMD_F1, a, b, c, d, e,  5, k,  8)
+	RMD_STEP(RMD_F5, ap, bp, cp, dp, ep,  2, kp, 15)
+	RMD_STEP(RMD_F1, e, a, b, c, d,  6, k,  7)
+	RMD_STEP(RMD_F5, ep, ap, bp, cp, dp, 11, kp, 15)
+	RMD_STEP(RMD_F1, d, e, a, b, c,  7, k,  9)
+	RMD_STEP(RMD_F5, dp, ep, ap, bp, cp,  4, kp,  5)
+	RMD_STEP(RMD_F1, c, d, e, a, b,  8, k, 11)
+	RMD_STEP(RMD_F5, cp, dp, ep, ap, bp, 13, kp,  7)
+	RMD_STEP(RMD_F1, b, c, d, e, a,  9, k, 13)
+	RMD_STEP(RMD_F5, bp, cp, dp, ep, ap,  6, kp,  7)
+	RMD_STEP(RMD_F1, a, b, c, d, e, 10, k, 14)
+	RMD_STEP(RMD_F5, ap, bp, cp, dp, ep, 15, kp,  8)
+	RMD_STEP(RMD_F1, e, a, b, c, d, 11, k, 15)
+	RMD_STEP(RMD_F5, ep, ap, bp, cp, dp,  8, kp, 11)
+	RMD_STEP(RMD_F1, d, e, a, b, c, 12, k,  6)
+	RMD_STEP(RMD_F5, dp, ep, ap, bp, cp,  1, kp, 14)
+	RMD_STEP(RMD_F1, c, d, e, a, b, 13, k,  7)
+	RMD_STEP(RMD_F5, cp, dp, ep, ap, bp, 10, kp, 14)
+	RMD_STEP(RMD_F1, b, c, d, e, a, 14, k,  9)
+	RMD_STEP(RMD_F5, bp, cp, dp, ep, ap,  3, kp, 12)
+	RMD_STEP(RMD_F1, a, b, c, d, e, 15, k,  8)
+	RMD_STEP(RMD_F5, ap, bp, cp, dp, ep, 12, kp,  6)
+
+/* Round 2 */
+	k = vset1_epi32(0x5A827999);
+	kp = vset1_epi32(0x5C4DD124);
+	RMD_STEP(RMD_F2, e, a, b, c, d,  7, k,  7)
+	RMD_STEP(RMD_F4, ep, ap, bp, cp, dp,  6, kp,  9)
+	RMD_STEP(RMD_F2, d, e, a, b, c,  4, k,  6)
+	RMD_STEP(RMD_F4, dp, ep, ap, bp, cp, 11, kp, 13)
+	RMD_STEP(RMD_F2, c, d, e, a, b, 13, k,  8)
+	RMD_STEP(RMD_F4, cp, dp, ep, ap, bp,  3, kp, 15)
+	RMD_STEP(RMD_F2, b, c, d, e, a,  1, k, 13)
+	RMD_STEP(RMD_F4, bp, cp, dp, ep, ap,  7, kp,  7)
+	RMD_STEP(RMD_F2, a, b, c, d, e, 10, k, 11)
+	RMD_STEP(RMD_F4, ap, bp, cp, dp, ep,  0, kp, 12)
+	RMD_STEP(RMD_F2, e, a, b, c, d,  6, k,  9)
+	RMD_STEP(RMD_F4, ep, ap, bp, cp, dp, 13, kp,  8)
+	RMD_STEP(RMD_F2, d, e, a, b, c, 15, k,  7)
+	RMD_STEP(RMD_F4, dp, ep, ap, bp, cp,  5, kp,  9)
+	RMD_STEP(RMD_F2, c, d, e, a, b,  3, k, 15)
+	RMD_STEP(RMD_F4, cp, dp, ep, ap, bp, 10, kp, 11)
+	RMD_STEP(RMD_F2, b, c, d, e, a, 12, k,  7)
+	RMD_STEP(RMD_F4, bp, cp, dp, ep, ap, 14, kp,  7)
+	RMD_STEP(RMD_F2, a, b, c, d, e,  0, k, 12)
+	RMD_STEP(RMD_F4, ap, bp, cp, dp, ep, 15, kp,  7)
+	RMD_STEP(RMD_F2, e, a, b, c, d,  9, k, 15)
+	RMD_STEP(RMD_F4, ep, ap, bp, cp, dp,  8, kp, 12)
+	RMD_STEP(RMD_F2, d, e, a, b, c,  5, k,  9)
+	RMD_STEP(RMD_F4, dp, ep, ap, bp, cp, 12, kp,  7)
+	RMD_STEP(RMD_F2, c, d, e, a, b,  2, k, 11)
+	RMD_STEP(RMD_F4, cp, dp, ep, ap, bp,  4, kp,  6)
+	RMD_STEP(RMD_F2, b, c, d, e, a, 14, k,  7)
+	RMD_STEP(RMD_F4, bp, cp, dp, ep, ap,  9, kp, 15)
+	RMD_STEP(RMD_F2, a, b, c, d, e, 11, k, 13)
+	RMD_STEP(RMD_F4, ap, bp, cp, dp, ep,  1, kp, 13)
+	RMD_STEP(RMD_F2, e, a, b, c, d,  8, k, 12)
+	RMD_STEP(RMD_F4, ep, ap, bp, cp, dp,  2, kp, 11)
+
+/* Round 3 */
+	k = vset1_epi32(0x6ED9EBA1);
+	kp = vset1_epi32(0x6D703EF3);
+	RMD_STEP(RMD_F3, d, e, a, b, c,  3, k, 11)
+	RMD_STEP(RMD_F3, dp, ep, ap, bp, cp, 15, kp,  9)
+	RMD_STEP(RMD_F3, c, d, e, a, b, 10, k, 13)
+	RMD_STEP(RMD_F3, cp, dp, ep, ap, bp,  5, kp,  7)
+	RMD_STEP(RMD_F3, b, c, d, e, a, 14, k,  6)
+	RMD_STEP(RMD_F3, bp, cp, dp, ep, ap,  1, kp, 15)
+	RMD_STEP(RMD_F3, a, b, c, d, e,  4, k,  7)
+	RMD_STEP(RMD_F3, ap, bp, cp, dp, ep,  3, kp, 11)
+	RMD_STEP(RMD_F3, e, a, b, c, d,  9, k, 14)
+	RMD_STEP(RMD_F3, ep, ap, bp, cp, dp,  7, kp,  8)
+	RMD_STEP(RMD_F3, d, e, a, b, c, 15, k,  9)
+	RMD_STEP(RMD_F3, dp, ep, ap, bp, cp, 14, kp,  6)
+	RMD_STEP(RMD_F3, c, d, e, a, b,  8, k, 13)
+	RMD_STEP(RMD_F3, cp, dp, ep, ap, bp,  6, kp,  6)
+	RMD_STEP(RMD_F3, b, c, d, e, a,  1, k, 15)
+	RMD_STEP(RMD_F3, bp, cp, dp, ep, ap,  9, kp, 14)
+	RMD_STEP(RMD_F3, a, b, c, d, e,  2, k, 14)
+	RMD_STEP(RMD_F3, ap, bp, cp, dp, ep, 11, kp, 12)
+	RMD_STEP(RMD_F3, e, a, b, c, d,  7, k,  8)
+	RMD_STEP(RMD_F3, ep, ap, bp, cp, dp,  8, kp, 13)
+	RMD_STEP(RMD_F3, d, e, a, b, c,  0, k, 13)
+	RMD_STEP(RMD_F3, dp, ep, ap, bp, cp, 12, kp,  5)
+	RMD_STEP(RMD_F3, c, d, e, a, b,  6, k,  6)
+	RMD_STEP(RMD_F3, cp, dp, ep, ap, bp,  2, kp, 14)
+	RMD_STEP(RMD_F3, b, c, d, e, a, 13, k,  5)
+	RMD_STEP(RMD_F3, bp, cp, dp, ep, ap, 10, kp, 13)
+	RMD_STEP(RMD_F3, a, b, c, d, e, 11, k, 12)
+	RMD_STEP(RMD_F3, ap, bp, cp, dp, ep,  0, kp, 13)
+	RMD_STEP(RMD_F3, e, a, b, c, d,  5, k,  7)
+	RMD_STEP(RMD_F3, ep, ap, bp, cp, dp,  4, kp,  7)
+	RMD_STEP(RMD_F3, d, e, a, b, c, 12, k,  5)
+	RMD_STEP(RMD_F3, dp, ep, ap, bp, cp, 13, kp,  5)
+
+/* Round 4 */
+	k = vset1_epi32(0x8F1BBCDC);
+	kp = vset1_epi32(0x7A6D76E9);
+	RMD_STEP(RMD_F4, c, d, e, a, b,  1, k, 11)
+	RMD_STEP(RMD_F2, cp, dp, ep, ap, bp,  8, kp, 15)
+	RMD_STEP(RMD_F4, b, c, d, e, a,  9, k, 12)
+	RMD_STEP(RMD_F2, bp, cp, dp, ep, ap,  6, kp,  5)
+	RMD_STEP(RMD_F4, a, b, c, d, e, 11, k, 14)
+	RMD_STEP(RMD_F2, ap, bp, cp, dp, ep,  4, kp,  8)
+	RMD_STEP(RMD_F4, e, a, b, c, d, 10, k, 15)
+	RMD_STEP(RMD_F2, ep, ap, bp, cp, dp,  1, kp, 11)
+	RMD_STEP(RMD_F4, d, e, a, b, c,  0, k, 14)
+	RMD_STEP(RMD_F2, dp, ep, ap, bp, cp,  3, kp, 14)
+	RMD_STEP(RMD_F4, c, d, e, a, b,  8, k, 15)
+	RMD_STEP(RMD_F2, cp, dp, ep, ap, bp, 11, kp, 14)
+	RMD_STEP(RMD_F4, b, c, d, e, a, 12, k,  9)
+	RMD_STEP(RMD_F2, bp, cp, dp, ep, ap, 15, kp,  6)
+	RMD_STEP(RMD_F4, a, b, c, d, e,  4, k,  8)
+	RMD_STEP(RMD_F2, ap, bp, cp, dp, ep,  0, kp, 14)
+	RMD_STEP(RMD_F4, e, a, b, c, d, 13, k,  9)
+	RMD_STEP(RMD_F2, ep, ap, bp, cp, dp,  5, kp,  6)
+	RMD_STEP(RMD_F4, d, e, a, b, c,  3, k, 14)
+	RMD_STEP(RMD_F2, dp, ep, ap, bp, cp, 12, kp,  9)
+	RMD_STEP(RMD_F4, c, d, e, a, b,  7, k,  5)
+	RMD_STEP(RMD_F2, cp, dp, ep, ap, bp,  2, kp, 12)
+	RMD_STEP(RMD_F4, b, c, d, e, a, 15, k,  6)
+	RMD_STEP(RMD_F2, bp, cp, dp, ep, ap, 13, kp,  9)
+	RMD_STEP(RMD_F4, a, b, c, d, e, 14, k,  8)
+	RMD_STEP(RMD_F2, ap, bp, cp, dp, ep,  9, kp, 12)
+	RMD_STEP(RMD_F4, e, a, b, c, d,  5, k,  6)
+	RMD_STEP(RMD_F2, ep, ap, bp, cp, dp,  7, kp,  5)
+	RMD_STEP(RMD_F4, d, e, a, b, c,  6, k,  5)
+	RMD_STEP(RMD_F2, dp, ep, ap, bp, cp, 10, kp, 15)
+	RMD_STEP(RMD_F4, c, d, e, a, b,  2, k, 12)
+	RMD_STEP(RMD_F2, cp, dp, ep, ap, bp, 14, kp,  8)
+
+/* Round 5 */
+	k = vset1_epi32(0xA953FD4E);
+	kp = vset1_epi32(0x00000000);
+	RMD_STEP(RMD_F5, b, c, d, e, a,  4, k,  9)
+	RMD_STEP(RMD_F1, bp, cp, dp, ep, ap, 12, kp,  8)
+	RMD_STEP(RMD_F5, a, b, c, d, e,  0, k, 15)
+	RMD_STEP(RMD_F1, ap, bp, cp, dp, ep, 15, kp,  5)
+	RMD_STEP(RMD_F5, e, a, b, c, d,  5, k,  5)
+	RMD_STEP(RMD_F1, ep, ap, bp, cp, dp, 10, kp, 12)
+	RMD_STEP(RMD_F5, d, e, a, b, c,  9, k, 11)
+	RMD_STEP(RMD_F1, dp, ep, ap, bp, cp,  4, kp,  9)
+	RMD_STEP(RMD_F5, c, d, e, a, b,  7, k,  6)
+	RMD_STEP(RMD_F1, cp, dp, ep, ap, bp,  1, kp, 12)
+	RMD_STEP(RMD_F5, b, c, d, e, a, 12, k,  8)
+	RMD_STEP(RMD_F1, bp, cp, dp, ep, ap,  5, kp,  5)
+	RMD_STEP(RMD_F5, a, b, c, d, e,  2, k, 13)
+	RMD_STEP(RMD_F1, ap, bp, cp, dp, ep,  8, kp, 14)
+	RMD_STEP(RMD_F5, e, a, b, c, d, 10, k, 12)
+	RMD_STEP(RMD_F1, ep, ap, bp, cp, dp,  7, kp,  6)
+	RMD_STEP(RMD_F5, d, e, a, b, c, 14, k,  5)
+	RMD_STEP(RMD_F1, dp, ep, ap, bp, cp,  6, kp,  8)
+	RMD_STEP(RMD_F5, c, d, e, a, b,  1, k, 12)
+	RMD_STEP(RMD_F1, cp, dp, ep, ap, bp,  2, kp, 13)
+	RMD_STEP(RMD_F5, b, c, d, e, a,  3, k, 13)
+	RMD_STEP(RMD_F1, bp, cp, dp, ep, ap, 13, kp,  6)
+	RMD_STEP(RMD_F5, a, b, c, d, e,  8, k, 14)
+	RMD_STEP(RMD_F1, ap, bp, cp, dp, ep, 14, kp,  5)
+	RMD_STEP(RMD_F5, e, a, b, c, d, 11, k, 11)
+	RMD_STEP(RMD_F1, ep, ap, bp, cp, dp,  0, kp, 15)
+	RMD_STEP(RMD_F5, d, e, a, b, c,  6, k,  8)
+	RMD_STEP(RMD_F1, dp, ep, ap, bp, cp,  3, kp, 13)
+	RMD_STEP(RMD_F5, c, d, e, a, b, 15, k,  5)
+	RMD_STEP(RMD_F1, cp, dp, ep, ap, bp,  9, kp, 11)
+	RMD_STEP(RMD_F5, b, c, d, e, a, 13, k,  6)
+	RMD_STEP(RMD_F1, bp, cp, dp, ep, ap, 11, kp, 11)
+
+	dp = vadd_epi32(vadd_epi32(h[1], c), dp);
+	vstore((vtype*)&out[1*VS32], vadd_epi32(vadd_epi32(h[2], d), ep));
+	vstore((vtype*)&out[2*VS32], vadd_epi32(vadd_epi32(h[3], e), ap));
+	vstore((vtype*)&out[3*VS32], vadd_epi32(vadd_epi32(h[4], a), bp));
+	vstore((vtype*)&out[4*VS32], vadd_epi32(vadd_epi32(h[0], b), cp));
+	vstore((vtype*)&out[0*VS32], dp);
+}
+
+#undef RMD_STEP
+#undef RMD_F5
+#undef RMD_F4
+#undef RMD_F3
+#undef RMD_F2
+#undef RMD_F1
+#endif /* SIMD_COEF_32 */
+
 
 #if SIMD_PARA_SHA1
 #define SHA1_PARA_DO(x)		for ((x)=0;(x)<SIMD_PARA_SHA1;(x)++)
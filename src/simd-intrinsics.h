@@ -95,6 +95,13 @@ void md4_unreverse(uint32_t *hash);
 #define MD4_ALGORITHM_NAME		"32/" ARCH_BITS_STR
 #endif
 
+#ifdef SIMD_COEF_32
+void SIMDripemd160body(vtype* data, uint32_t *out, uint32_t *reload_state, unsigned SSEi_flags);
+#define RIPEMD160_ALGORITHM_NAME	BITS " " SIMD_TYPE " " PARA_TO_N(SIMD_COEF_32)
+#else
+#define RIPEMD160_ALGORITHM_NAME	"32/" ARCH_BITS_STR
+#endif
+
 #ifdef SIMD_PARA_SHA1
 void SIMDSHA1body(vtype* data, uint32_t *out, uint32_t *reload_state, unsigned SSEi_flags);
 void sha1_reverse(uint32_t *hash);
@@ -57,6 +57,13 @@ static int ocl_fmt;
 #endif /* HAVE_OPENCL || HAVE_ZTEX */
 
 static int single_disabled_recursion;
+static int split_salts, my_salt_count;
+
+/* Memory left for per-user arrays of words and word pairs, or -1 for no limit */
+static int64_t pairs_mem_left;
+
+/* Marks the end of a word pairs array, where a split position would be */
+#define PAIRS_END			0xff
 
 static void save_state(FILE *file)
 {
@@ -114,7 +121,47 @@ static uint64_t calc_buf_size(int length, int min_kpc)
 
 	res += (sizeof(struct db_keys) - 1 + length * min_kpc);
 
-	return res * single_db->salt_count;
+	return res * my_salt_count;
+}
+
+/*
+ * With salts split between nodes, we pick ours by a digest of the salt, so
+ * that it doesn't change as other salts get cracked and removed.
+ */
+static int single_salt_is_mine(struct db_salt *salt)
+{
+	unsigned int for_node = salt->salt_md5[0] % options.node_count + 1;
+
+	return for_node >= options.node_min && for_node <= options.node_max;
+}
+
+static void single_split_salts(void)
+{
+	struct db_salt *salt;
+	int min;
+
+	split_salts = 0;
+	my_salt_count = single_db->salt_count;
+
+	if (!options.node_count)
+		return;
+
+	if ((min = cfg_get_int(SECTION_OPTIONS, NULL, "SingleSplitSaltsMin")) < 0)
+		min = SINGLE_SPLIT_SALTS_MIN;
+
+	if (!min || single_db->salt_count < 2 ||
+	    single_db->salt_count / options.node_count < min)
+		return;
+
+	split_salts = 1;
+	my_salt_count = 0;
+	salt = single_db->salts;
+	do {
+		my_salt_count += single_salt_is_mine(salt);
+	} while ((salt = salt->next));
+
+	log_event("- Splitting salts between nodes, %d of %d salts are ours",
+	          my_salt_count, single_db->salt_count);
 }
 
 static void single_alloc_keys(struct db_keys **keys)
@@ -236,6 +283,8 @@ static void single_init(void)
 
 	my_buf_share = (int64_t)max_buffer_GB << 30;
 
+	single_split_salts();
+
 #if HAVE_MPI
 	if (mpi_p_local > 1)
 		my_buf_share /= mpi_p_local;
@@ -471,21 +520,25 @@ static void single_init(void)
 
 	salt = single_db->salts;
 	do {
-		single_alloc_keys(&salt->keys);
+		if (!split_salts || single_salt_is_mine(salt))
+			single_alloc_keys(&salt->keys);
 	} while ((salt = salt->next));
 
 	if (key_count > 1)
 		log_event("- Allocated %d buffer%s of %d candidate passwords"
 		          "%s (total %sB)",
-		          single_db->salt_count,
-		          single_db->salt_count != 1 ? "s" : "",
+		          my_salt_count,
+		          my_salt_count != 1 ? "s" : "",
 		          key_count,
-		          single_db->salt_count != 1 ? " each" : "",
+		          my_salt_count != 1 ? " each" : "",
 		          human_prefix(calc_buf_size(length, key_count)));
 
 	guessed_keys = NULL;
 	single_alloc_keys(&guessed_keys);
 
+	pairs_mem_left = my_buf_share ?
+		my_buf_share - (int64_t)calc_buf_size(length, key_count) : -1;
+
 	crk_init(single_db, NULL, guessed_keys);
 }
 
@@ -631,7 +684,8 @@ static int single_process_buffer(struct db_salt *salt)
 		do {
 			current = single_db->salts;
 			do {
-				if (current == salt || !current->list)
+				if (current == salt || !current->list ||
+				    !current->keys)
 					continue;
 
 				if (single_add_key(current, keys->ptr, 1)) {
@@ -656,32 +710,38 @@ static int single_process_buffer(struct db_salt *salt)
 	return 0;
 }
 
-static int single_process_pw(struct db_salt *salt, struct db_password *pw,
-	char *rule)
+/*
+ * Put all of a user's words, and pairs of them, in the order we try them in
+ * one array of split position + NUL terminated string entries.  These never
+ * change, so we build them once rather than for every rule.
+ */
+static char *single_build_pairs(struct db_password *pw)
 {
+	static char *buf;
+	static size_t buf_size;
 	struct list_entry *first, *second;
 	struct list_entry *global_head = single_seed->head;
 	int first_global, second_global;
 	int first_number, second_number;
 	char pair[RULE_WORD_SIZE];
-	int split;
-	char *key;
-
-	if (!(first = pw->words->head))
-		return -1;
-
+	size_t size = 0;
+
+#define add_pair(word, split) \
+	do { \
+		size_t len = strlen(word) + 1; \
+		if (size + len + 2 > buf_size) \
+			buf = mem_realloc(buf, buf_size = 2 * (size + len + 2)); \
+		buf[size++] = split; \
+		memcpy(&buf[size], word, len); \
+		size += len; \
+	} while (0)
+
+	first = pw->words->head;
 	first_number = first_global = 0;
 	do {
 		if (first == global_head)
 			first_global = 1;
-		if ((key = rules_apply(first->data, rule, 0, NULL)))
-		if (ext_filter(key))
-		if (single_add_key(salt, key, 0))
-			return 1;
-		if (!salt->list)
-			return 2;
-		if (!pw->binary)
-			return 0;
+		add_pair(first->data, 0);
 
 		if (++first_number > words_pair_max)
 			continue;
@@ -693,6 +753,8 @@ static int single_process_pw(struct db_salt *salt, struct db_password *pw,
 		second = pw->words->head;
 
 		do {
+			int split;
+
 			if (second == global_head)
 				second_global = 1;
 			if (first == second || (first_global && second_global))
@@ -700,35 +762,62 @@ static int single_process_pw(struct db_salt *salt, struct db_password *pw,
 			if ((split = strlen(first->data)) < length) {
 				strnzcpy(pair, first->data, RULE_WORD_SIZE);
 				strnzcat(pair, second->data, RULE_WORD_SIZE);
-
-				if ((key = rules_apply(pair, rule, split, NULL)))
-				if (ext_filter(key))
-				if (single_add_key(salt, key, 0))
-					return 1;
-				if (!salt->list)
-					return 2;
-				if (!pw->binary)
-					return 0;
+				add_pair(pair, split);
 			}
 
 			if (!first_global && first->data[1]) {
 				pair[0] = first->data[0];
 				pair[1] = 0;
 				strnzcat(pair, second->data, RULE_WORD_SIZE);
-
-				if ((key = rules_apply(pair, rule, 1, NULL)))
-				if (ext_filter(key))
-				if (single_add_key(salt, key, 0))
-					return 1;
-				if (!salt->list)
-					return 2;
-				if (!pw->binary)
-					return 0;
+				add_pair(pair, 1);
 			}
 		} while (++second_number <= words_pair_max &&
 			(second = second->next));
 	} while ((first = first->next));
 
+#undef add_pair
+
+	buf[size++] = (char)PAIRS_END;
+
+	/* Keep them if we have the memory, or else we'll build them again */
+	if (pairs_mem_left >= 0) {
+		if ((int64_t)size > pairs_mem_left)
+			return buf;
+		pairs_mem_left -= size;
+	}
+
+	pw->pairs = mem_alloc_tiny(size, MEM_ALIGN_NONE);
+	memcpy(pw->pairs, buf, size);
+
+	return pw->pairs;
+}
+
+static int single_process_pw(struct db_salt *salt, struct db_password *pw,
+	char *rule)
+{
+	unsigned char *pairs;
+	char *key;
+
+	if (!pw->words->head)
+		return -1;
+
+	pairs = (unsigned char *)(pw->pairs ? pw->pairs : single_build_pairs(pw));
+
+	while (*pairs != PAIRS_END) {
+		char *word = (char *)pairs + 1;
+
+		if ((key = rules_apply(word, rule, *pairs, NULL)))
+		if (ext_filter(key))
+		if (single_add_key(salt, key, 0))
+			return 1;
+		if (!salt->list)
+			return 2;
+		if (!pw->binary)
+			return 0;
+
+		pairs = (unsigned char *)word + strlen(word) + 1;
+	}
+
 	return 0;
 }
 
@@ -808,7 +897,8 @@ static void single_run(void)
 		while ((prerule = rpp_next(rule_ctx))) {
 			int sc = single_db->salt_count;
 
-			if (options.node_count && strncmp(prerule, "!!", 2)) {
+			if (options.node_count && !split_salts &&
+			    strncmp(prerule, "!!", 2)) {
 				int for_node = rule_number % options.node_count + 1;
 				if (for_node < options.node_min ||
 				    for_node > options.node_max) {
@@ -859,7 +949,7 @@ static void single_run(void)
 			if (!(salt = single_db->salts))
 				return;
 			do {
-				if (!salt->list)
+				if (!salt->list || !salt->keys)
 					continue;
 				if (single_process_salt(salt, rule))
 					return;
@@ -925,7 +1015,7 @@ static void single_done(void)
 			}
 
 			do {
-				if (!salt->list)
+				if (!salt->list || !salt->keys)
 					continue;
 				if (salt->keys->count)
 					if (single_process_buffer(salt))
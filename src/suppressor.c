@@ -4,6 +4,14 @@
  */
 
 #include <stdint.h>
+#include <string.h>
+
+#include "arch.h"
+#include "params.h"
+
+#if SUPPRESSOR_PREFETCH && defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 #include "common.h"
 #include "memory.h"
@@ -11,7 +19,9 @@
 #include "cracker.h"
 #include "logger.h"
 #include "options.h"
+#include "signals.h"
 #include "status.h"
+#include "misc.h"
 #include "suppressor.h"
 
 #define DEFAULT_SIZE 256 /* MiB */
@@ -22,8 +32,25 @@ static uint64_t (*filter)[K];
 static unsigned int flags;
 
 static int (*old_process_key)(char *key);
+static void (*old_fix_state)(void);
 
 static int suppressor_process_key(char *key);
+static void suppressor_fix_state(void);
+
+/*
+ * Candidates held back while their filter buckets are being prefetched.  They
+ * are passed on in the order received, so the outcome is the same as without
+ * the prefetching, just with the DRAM latency of one lookup overlapped with
+ * hashing of the next few candidates.
+ */
+#if SUPPRESSOR_PREFETCH
+static struct {
+	uint64_t hash;
+	uint32_t bucket;
+	char key[PLAINTEXT_BUFFER_SIZE];
+} held[SUPPRESSOR_PREFETCH];
+#endif
+static unsigned int held_first, held_count, held_max, fix_state_pending;
 
 void suppressor_init(unsigned int new_flags)
 {
@@ -68,6 +95,22 @@ void suppressor_init(unsigned int new_flags)
 	status.suppressor_end_time = 0;
 	old_process_key = crk_process_key;
 	crk_process_key = suppressor_process_key;
+
+/*
+ * Holding candidates back requires that we see the cracking mode's state being
+ * recorded, which isn't the case for the hybrid and stacked modes that have
+ * fix_state() hooks of their own.
+ */
+	held_first = held_count = fix_state_pending = 0;
+	held_max = 0;
+#if SUPPRESSOR_PREFETCH
+	if (!(options.flags & (FLG_MASK_STACKED | FLG_REGEX_STACKED | FLG_EXTERNAL_CHK)))
+		held_max = SUPPRESSOR_PREFETCH;
+#endif
+	if (crk_fix_state != suppressor_fix_state) {
+		old_fix_state = crk_fix_state;
+		crk_fix_state = suppressor_fix_state;
+	}
 }
 
 static void suppressor_done(void)
@@ -85,6 +128,21 @@ static void suppressor_done(void)
 	status.suppressor_end = status.cands;
 	status.suppressor_end_time = status_get_time();
 	crk_process_key = old_process_key;
+	if (!held_count && crk_fix_state == suppressor_fix_state)
+		crk_fix_state = old_fix_state;
+}
+
+/*
+ * The cracker asks for the mode's state to be recorded when it has completed
+ * a batch.  If we're holding candidates back at that time, the mode is already
+ * past them, so we postpone this until we've passed on everything we held.
+ */
+static void suppressor_fix_state(void)
+{
+	if (held_count)
+		fix_state_pending = 1;
+	else
+		old_fix_state();
 }
 
 /*
@@ -93,46 +151,46 @@ static void suppressor_done(void)
  * 2. A 64-bit password "hash" that is basically the password for lengths up
  * up to 8 inclusive, and a value that is guaranteed not to collide with any
  * short pure 7-bit ASCII password for greater lengths.
+ * The password is processed 8 bytes at a time.
  */
 static MAYBE_INLINE uint32_t key_hash(const char *key, uint64_t *hash2)
 {
-	const unsigned char *p = (const unsigned char *)key;
-	unsigned char *q = (unsigned char *)hash2;
-	uint32_t hash1, extra;
+	const char *start = key;
+	size_t len = strlen(key);
+	uint64_t hash1, word;
 
 	*hash2 = 1;
-	hash1 = extra = 0;
+	hash1 = len;
 
-	while (*p) {
-		if (q >= (unsigned char *)hash2 + 8) {
-			q = (unsigned char *)hash2;
-			*hash2 += ((uint64_t)hash1 << 32) | extra;
-		}
-		q[0] ^= p[0];
-		hash1 += p[0];
-		hash1 *= 0x5a827999;
-		if (!p[1])
+	while (1) {
+		word = 0;
+		memcpy(&word, key, len < 8 ? len : 8);
+		*hash2 ^= word;
+		hash1 ^= word;
+		hash1 *= 0x5a8279996ed9eba1ULL;
+		hash1 ^= hash1 >> 29;
+		if (len <= 8)
 			break;
-		q[1] ^= p[1];
-		extra += p[1];
-		extra *= 0x6ed9eba1;
-		p += 2; q += 2;
+		*hash2 += hash1;
+		key += 8;
+		len -= 8;
 	}
 
-	if (p - (const unsigned char *)key + !!*p > 8) /* different hash than for any short 7-bit */
+	if (key != start) /* different hash than for any short 7-bit */
 		((unsigned char *)hash2)[7] |= 0x80;
 
-	hash1 ^= extra;
-
-	return hash1;
+	hash1 ^= hash1 >> 32;
+	hash1 *= 0x8f1bbcdc;
+	return hash1 >> 32;
 }
 
-static int suppressor_process_key(char *key)
+/*
+ * Returns non-zero if the candidate is a likely duplicate.  Otherwise, records
+ * it in the filter (if we're updating it) and returns zero.
+ */
+static MAYBE_INLINE int suppressor_check(uint64_t hash, uint32_t i)
 {
-	uint64_t hash;
-	unsigned int i, j;
-
-	i = ((uint64_t)key_hash(key, &hash) * N) >> 32;
+	unsigned int j;
 
 	/* lookup */
 	for (j = 0; j < K && filter[i][j]; j++) {
@@ -142,7 +200,7 @@ static int suppressor_process_key(char *key)
 				filter[i][j + 1] = hash; /* postpone eviction of this hash */
 			}
 			status.suppressor_hit++;
-			return 0;
+			return 1;
 		}
 	}
 
@@ -169,5 +227,79 @@ static int suppressor_process_key(char *key)
 			suppressor_done();
 	}
 
+	return 0;
+}
+
+#if SUPPRESSOR_PREFETCH
+/*
+ * Pass on the oldest held candidate, or all of them if asked to or if the
+ * cracker wants the mode's state recorded.  In the latter case, we ask the
+ * cracker to do that again after its current batch, and until then we pass
+ * candidates through without holding them back.
+ */
+static int suppressor_pass_held(int all)
+{
+	int ret = 0;
+
+	do {
+		unsigned int slot = held_first;
+		held_first = (held_first + 1) % SUPPRESSOR_PREFETCH;
+		held_count--;
+		if (flags && suppressor_check(held[slot].hash, held[slot].bucket))
+			continue;
+		if ((ret = old_process_key(held[slot].key))) {
+			held_count = 0;
+			break;
+		}
+	} while (held_count && (all || event_fix_state || fix_state_pending || !flags));
+
+	if (!held_count && fix_state_pending) {
+		fix_state_pending = 0;
+		event_fix_state = 1;
+	}
+
+	if (!flags && !held_count && crk_fix_state == suppressor_fix_state)
+		crk_fix_state = old_fix_state;
+
+	return ret;
+}
+#endif
+
+static int suppressor_process_key(char *key)
+{
+	uint64_t hash;
+	uint32_t i;
+
+	i = ((uint64_t)key_hash(key, &hash) * N) >> 32;
+
+#if SUPPRESSOR_PREFETCH
+	if (held_max) {
+		unsigned int slot = (held_first + held_count) % SUPPRESSOR_PREFETCH;
+
+		_mm_prefetch((const char *)filter[i], _MM_HINT_T0);
+		held[slot].hash = hash;
+		held[slot].bucket = i;
+		strnzcpy(held[slot].key, key, sizeof(held[slot].key));
+
+		if (++held_count < held_max && !event_fix_state && !fix_state_pending)
+			return 0;
+
+		return suppressor_pass_held(0);
+	}
+#endif
+
+	if (suppressor_check(hash, i))
+		return 0;
+
 	return old_process_key(key);
 }
+
+int suppressor_flush(void)
+{
+#if SUPPRESSOR_PREFETCH
+	if (held_count)
+		return suppressor_pass_held(1);
+#endif
+
+	return 0;
+}
@@ -24,4 +24,11 @@
  */
 extern void suppressor_init(unsigned int flags);
 
+/*
+ * Passes on any candidates the suppressor is still holding back while their
+ * filter buckets are being prefetched.  Called from crk_done().  The return
+ * value is the same as for crk_process_key().
+ */
+extern int suppressor_flush(void);
+
 #endif
@@ -77,6 +77,20 @@ john_register_one(&fmt_truecrypt_whirlpool);
 #define OMP_SCALE               8 // Tuned w/ MKPC for core i7
 #endif
 
+#if SSE_GROUP_SZ_SHA512
+#define SHA512_BATCH_SZ         SSE_GROUP_SZ_SHA512
+#else
+#define SHA512_BATCH_SZ         1
+#endif
+#if SSE_GROUP_SZ_RIPEMD160
+#define RIPEMD160_BATCH_SZ      SSE_GROUP_SZ_RIPEMD160
+#else
+#define RIPEMD160_BATCH_SZ      1
+#endif
+/* Both are powers of two, so this is a multiple of either */
+#define INNER_BATCH_MAX_SZ      (SHA512_BATCH_SZ > RIPEMD160_BATCH_SZ ? \
+                                 SHA512_BATCH_SZ : RIPEMD160_BATCH_SZ)
+
 static unsigned char (*key_buffer)[PLAINTEXT_LENGTH + 1];
 static unsigned char (*first_block_dec)[16];
 
@@ -418,24 +432,15 @@ static int decrypt_and_verify(unsigned char *key, int algorithm)
 
 	// We have 448 bytes of header (64 bytes unencrypted salt were the
 	// first 64 bytes). Decrypt it and look for 3 items.
-	switch (algorithm) {
-		case 0:
-			XTS_decrypt(key, decr_header, psalt->bin, 512-64, 256, 0);
-			break;
-		case 1:
-			XTS_decrypt(key, decr_header, psalt->bin, 512-64, 256, 1);
-			// Twofish_XTS_decrypt(key, decr_header, psalt->bin, 512-64, 256);
-			break;
-		case 2:
-			XTS_decrypt(key, decr_header, psalt->bin, 512-64, 256, 2);
-			// Serpent_XTS_decrypt(key, decr_header, psalt->bin, 512-64, 256);
-			break;
-	}
-
 	// First item we look for is a contstant string 'TRUE' in the first 4 bytes.
+	// That is all in the first block, so only decrypt that one to begin with.
+	// Nearly all candidates are rejected here, for 1/28 of the XTS work.
+	XTS_decrypt(key, decr_header, psalt->bin, 16, 256, algorithm);
 	if (memcmp(decr_header, "TRUE", 4))
 		return 0;
 
+	XTS_decrypt(key, decr_header, psalt->bin, 512-64, 256, algorithm);
+
 	// Now we look for 2 crc values. At offset 8 is the first. This provided
 	// CRC should be the crc32 of the last 256 bytes of the buffer.
 	CRC32_Init(&check_sum);
@@ -463,13 +468,13 @@ static int crypt_all(int *pcount, struct db_salt *salt)
 	int i;
 	const int count = *pcount;
 
-#if SSE_GROUP_SZ_SHA512
-#define INNER_BATCH_MAX_SZ SSE_GROUP_SZ_SHA512
+#if INNER_BATCH_MAX_SZ > 1
 	int inner_batch_size = 1;
 	if (psalt->hash_type == IS_SHA512)
-		inner_batch_size = SSE_GROUP_SZ_SHA512;
+		inner_batch_size = SHA512_BATCH_SZ;
+	else if (psalt->hash_type == IS_RIPEMD160 || psalt->hash_type == IS_RIPEMD160BOOT)
+		inner_batch_size = RIPEMD160_BATCH_SZ;
 #else
-#define INNER_BATCH_MAX_SZ 1
 #define inner_batch_size 1
 #endif
 
@@ -510,8 +515,19 @@ static int crypt_all(int *pcount, struct db_salt *salt)
 			pbkdf2_sha512((const unsigned char*)keys[0], lens[0], psalt->salt, 64, psalt->num_iterations, keys[0], sizeof(keys[0]), 0);
 #endif
 		}
-		else if (psalt->hash_type == IS_RIPEMD160 || psalt->hash_type == IS_RIPEMD160BOOT)
+		else if (psalt->hash_type == IS_RIPEMD160 || psalt->hash_type == IS_RIPEMD160BOOT) {
+#if SSE_GROUP_SZ_RIPEMD160
+			unsigned char *pin[SSE_GROUP_SZ_RIPEMD160];
+			unsigned char *pout[SSE_GROUP_SZ_RIPEMD160];
+			for (j = 0; j < SSE_GROUP_SZ_RIPEMD160; ++j) {
+				pin[j] = keys[j];
+				pout[j] = keys[j];
+			}
+			pbkdf2_ripemd160_sse((const unsigned char **)pin, lens, psalt->salt, 64, psalt->num_iterations, pout, sizeof(keys[0]), 0);
+#else
 			pbkdf2_ripemd160((const unsigned char*)keys[0], lens[0], psalt->salt, 64, psalt->num_iterations, keys[0], sizeof(keys[0]), 0);
+#endif
+		}
 		else
 			pbkdf2_whirlpool((const unsigned char*)keys[0], lens[0], psalt->salt, 64, psalt->num_iterations, keys[0], sizeof(keys[0]), 0);
 
@@ -590,9 +606,9 @@ struct fmt_main fmt_truecrypt = {
 		BINARY_ALIGN,
 		SALT_SIZE,
 		SALT_ALIGN,
-#if SSE_GROUP_SZ_SHA512
-		SSE_GROUP_SZ_SHA512,
-		(SSE_GROUP_SZ_SHA512 * 4),
+#if INNER_BATCH_MAX_SZ > 1
+		INNER_BATCH_MAX_SZ,
+		(INNER_BATCH_MAX_SZ * 4),
 #else
 		MIN_KEYS_PER_CRYPT,
 		MAX_KEYS_PER_CRYPT,
@@ -643,7 +659,7 @@ struct fmt_main fmt_truecrypt_ripemd160 = {
 	{
 		"tc_ripemd160",                   // FORMAT_LABEL
 		"TrueCrypt AES256_XTS", // FORMAT_NAME
-		"RIPEMD160 32/" ARCH_BITS_STR,    // ALGORITHM_NAME,
+		"RIPEMD160 " RIPEMD160_ALGORITHM_NAME, // ALGORITHM_NAME,
 		"",                               // BENCHMARK_COMMENT
 		0x107,                            // BENCHMARK_LENGTH
 		0,
@@ -652,8 +668,13 @@ struct fmt_main fmt_truecrypt_ripemd160 = {
 		BINARY_ALIGN,
 		SALT_SIZE,
 		SALT_ALIGN,
+#if SSE_GROUP_SZ_RIPEMD160
+		SSE_GROUP_SZ_RIPEMD160,
+		(SSE_GROUP_SZ_RIPEMD160 * 4),
+#else
 		MIN_KEYS_PER_CRYPT,
 		MAX_KEYS_PER_CRYPT,
+#endif
 		FMT_CASE | FMT_8_BIT | FMT_OMP | FMT_HUGE_INPUT,
 		{ NULL },
 		{ TAG_RIPEMD160 },
@@ -692,7 +713,7 @@ struct fmt_main fmt_truecrypt_ripemd160boot = {
 	{
 		"tc_ripemd160boot", // FORMAT_LABEL
 		"TrueCrypt AES/Twofish/Serpent", // FORMAT_NAME
-		"RIPEMD160 32/" ARCH_BITS_STR, // ALGORITHM_NAME,
+		"RIPEMD160 " RIPEMD160_ALGORITHM_NAME, // ALGORITHM_NAME,
 		"", // BENCHMARK_COMMENT
 		0x107, // BENCHMARK_LENGTH
 		0,
@@ -701,8 +722,13 @@ struct fmt_main fmt_truecrypt_ripemd160boot = {
 		BINARY_ALIGN,
 		SALT_SIZE,
 		SALT_ALIGN,
+#if SSE_GROUP_SZ_RIPEMD160
+		SSE_GROUP_SZ_RIPEMD160,
+		(SSE_GROUP_SZ_RIPEMD160 * 4),
+#else
 		MIN_KEYS_PER_CRYPT,
 		MAX_KEYS_PER_CRYPT,
+#endif
 		FMT_CASE | FMT_8_BIT | FMT_OMP | FMT_HUGE_INPUT,
 		{ NULL },
 		{ TAG_RIPEMD160BOOT },
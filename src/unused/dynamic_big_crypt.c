@@ -94,6 +94,9 @@
 #include "dynamic.h"
 #include "johnswap.h"
 #include "simd-intrinsics.h"
+#if __SSE2__
+#include <emmintrin.h>
+#endif
 #include "dynamic_types.h"
 
 /*
@@ -353,9 +356,40 @@ void DynamicFunc__LargeHash_set_offset_saltlen(DYNA_OMP_PARAMS)
  *****  helpers.  Doing things like this will reduce the size of the large hash
  *****  primitive functions.
  ******************************************************************************/
+#if __SSE2__
+/*
+ * Writes 16 bytes as 32 base-16 digits.  letter is what to add to a digit's
+ * 0..9 ASCII value to get a..f, so 'a'-'0'-10 for lower case and 'A'-'0'-10
+ * for upper case.  Nibbles are split out and interleaved in registers, so
+ * this takes no table lookups.
+ */
+inline static void hex_out_16(unsigned char *cpi, unsigned char *cpo, __m128i letter)
+{
+	__m128i in = _mm_loadu_si128((__m128i*)cpi);
+	__m128i nibble = _mm_set1_epi8(0x0f);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), nibble);
+	__m128i lo = _mm_and_si128(in, nibble);
+	__m128i a = _mm_unpacklo_epi8(hi, lo);
+	__m128i b = _mm_unpackhi_epi8(hi, lo);
+	__m128i nine = _mm_set1_epi8(9), zero = _mm_set1_epi8('0');
+
+	a = _mm_add_epi8(_mm_add_epi8(a, zero), _mm_and_si128(_mm_cmpgt_epi8(a, nine), letter));
+	b = _mm_add_epi8(_mm_add_epi8(b, zero), _mm_and_si128(_mm_cmpgt_epi8(b, nine), letter));
+	_mm_storeu_si128((__m128i*)cpo, a);
+	_mm_storeu_si128((__m128i*)(cpo + 16), b);
+}
+#endif
+
 inline static unsigned char *hex_out_buf(unsigned char *cpi, unsigned char *cpo, int in_byte_cnt)
 {
 	unsigned int j;
+#if __SSE2__
+	// itoa16_w2 is either the lower or the upper case table, see which.
+	__m128i letter = _mm_set1_epi8(((unsigned char*)&itoa16_w2[0xa])[1] - '0' - 10);
+
+	for (; in_byte_cnt >= 16; in_byte_cnt -= 16, cpi += 16, cpo += 32)
+		hex_out_16(cpi, cpo, letter);
+#endif
 	for (j = 0; j < in_byte_cnt; ++j) {
 #if ARCH_ALLOWS_UNALIGNED
 		*((unsigned short*)cpo) = itoa16_w2[*cpi++];
@@ -373,6 +407,12 @@ inline static unsigned char *hex_out_buf(unsigned char *cpi, unsigned char *cpo,
 inline static unsigned char *hexu_out_buf(unsigned char *cpi, unsigned char *cpo, int in_byte_cnt)
 {
 	unsigned int j;
+#if __SSE2__
+	__m128i letter = _mm_set1_epi8('A' - '0' - 10);
+
+	for (; in_byte_cnt >= 16; in_byte_cnt -= 16, cpi += 16, cpo += 32)
+		hex_out_16(cpi, cpo, letter);
+#endif
 	for (j = 0; j < in_byte_cnt; ++j) {
 #if ARCH_ALLOWS_UNALIGNED
 		*((unsigned short*)cpo) = itoa16_w2_u[*cpi++];
@@ -0,0 +1 @@
+#define JTR_GIT_VERSION JUMBO_VERSION "-b0078e7" " 2026-10-16 22:46:52 +0000"
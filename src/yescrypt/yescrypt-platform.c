@@ -58,6 +58,10 @@ static void *alloc_region(yescrypt_region_t *region, size_t size)
 	} else if (flags & MAP_HUGETLB) {
 		flags &= ~MAP_HUGETLB;
 		base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+#ifdef MADV_HUGEPAGE
+		if (base != MAP_FAILED)
+			madvise(base, size, MADV_HUGEPAGE);
+#endif
 	}
 
 #else